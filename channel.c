@@ -0,0 +1,259 @@
+/* channel.c - Channels between interpreters
+ *
+ * Copyright (c) 2012 Janosch Gräf <janosch.graef@gmx.net>
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <glib.h>
+
+#include "push.h"
+
+
+
+/* destroys a value that doesn't belong to an interpreter, with all values in it */
+static void push_channel_val_destroy(push_val_t *val) {
+  GPtrArray *vals;
+  push_code_walk_t walk;
+  push_val_t *val2;
+  guint i;
+
+  if (push_check_code(val)) {
+    /* NOTE: collect first, since destroying code frees the list the walk is in */
+    vals = g_ptr_array_new();
+    push_code_walk_init(&walk, val->code);
+    while ((val2 = push_code_walk_next(&walk)) != NULL) {
+      g_ptr_array_add(vals, val2);
+    }
+    push_code_walk_clear(&walk);
+
+    for (i = 0; i < vals->len; i++) {
+      push_val_destroy((push_val_t*)g_ptr_array_index(vals, i));
+    }
+    g_ptr_array_free(vals, TRUE);
+  }
+
+  push_val_destroy(val);
+}
+
+
+push_channel_t *push_channel_new(void) {
+  push_channel_t *channel;
+  push_channel_node_t *node;
+
+  node = g_slice_new(push_channel_node_t);
+  node->next = NULL;
+  node->val = NULL;
+
+  channel = g_slice_new(push_channel_t);
+  channel->head = node;
+  channel->tail = node;
+  channel->length = 0;
+  channel->receiving = 0;
+  channel->waitq = push_vm_waitq_new();
+
+  return channel;
+}
+
+
+/* NOTE: nobody may use the channel anymore */
+void push_channel_destroy(push_channel_t *channel) {
+  push_channel_node_t *node, *next_node;
+
+  g_return_if_null(channel);
+
+  for (node = channel->tail; node != NULL; node = next_node) {
+    next_node = node->next;
+    if (node->val != NULL) {
+      push_channel_val_destroy(node->val);
+    }
+    g_slice_free(push_channel_node_t, node);
+  }
+
+  push_vm_waitq_destroy(channel->waitq);
+
+  g_slice_free(push_channel_t, channel);
+}
+
+
+/* Sends a copy of val and wakes up processes waiting for it */
+void push_channel_send(push_channel_t *channel, push_val_t *val) {
+  push_channel_node_t *node, *prev_node;
+
+  g_return_if_null(channel);
+  g_return_if_null(val);
+
+  node = g_slice_new(push_channel_node_t);
+  node->next = NULL;
+  node->val = push_val_copy(val, NULL);
+
+  do {
+    prev_node = (push_channel_node_t*)g_atomic_pointer_get(&channel->head);
+  } while (!g_atomic_pointer_compare_and_exchange(&channel->head, prev_node, node));
+
+  /* NOTE: until this is set the receiver sees the channel as empty */
+  g_atomic_pointer_set(&prev_node->next, node);
+
+  g_atomic_int_inc(&channel->length);
+  push_vm_waitq_signal(channel->waitq);
+}
+
+
+/* Takes the oldest value from the channel and copies it into push
+ * NOTE: Returns NULL if there is no value, or if another interpreter is
+ *       taking one right now (check push_channel_length).
+ */
+push_val_t *push_channel_recv(push_channel_t *channel, push_t *push) {
+  push_channel_node_t *tail, *next_node;
+  push_val_t *val, *new_val;
+
+  g_return_val_if_null(channel, NULL);
+
+  if (!g_atomic_int_compare_and_exchange(&channel->receiving, 0, 1)) {
+    return NULL;
+  }
+
+  tail = channel->tail;
+  next_node = (push_channel_node_t*)g_atomic_pointer_get(&tail->next);
+  if (next_node == NULL) {
+    g_atomic_int_set(&channel->receiving, 0);
+    return NULL;
+  }
+
+  /* next_node becomes the node before the oldest value */
+  val = next_node->val;
+  next_node->val = NULL;
+  channel->tail = next_node;
+  g_atomic_int_add(&channel->length, -1);
+
+  g_atomic_int_set(&channel->receiving, 0);
+
+  g_slice_free(push_channel_node_t, tail);
+
+  /* NOTE: the copy resolves instructions in push's instruction set */
+  new_val = push_val_copy(val, push);
+  push_channel_val_destroy(val);
+
+  return new_val;
+}
+
+
+push_int_t push_channel_length(push_channel_t *channel) {
+  g_return_val_if_null(channel, 0);
+
+  return g_atomic_int_get(&channel->length);
+}
+
+
+push_channels_t *push_channels_new(push_int_t num) {
+  push_channels_t *channels;
+  push_int_t i;
+
+  g_return_val_if_fail(num > 0, NULL);
+
+  channels = g_slice_new(push_channels_t);
+  channels->num = num;
+  channels->channels = g_new(push_channel_t*, num);
+  for (i = 0; i < num; i++) {
+    channels->channels[i] = push_channel_new();
+  }
+
+  return channels;
+}
+
+
+void push_channels_destroy(push_channels_t *channels) {
+  push_int_t i;
+
+  g_return_if_null(channels);
+
+  for (i = 0; i < channels->num; i++) {
+    push_channel_destroy(channels->channels[i]);
+  }
+  g_free(channels->channels);
+
+  g_slice_free(push_channels_t, channels);
+}
+
+
+/* NOTE: any number is a valid id (taken modulo the number of channels) */
+push_channel_t *push_channels_get(push_channels_t *channels, push_int_t id) {
+  g_return_val_if_null(channels, NULL);
+
+  return channels->channels[((id % channels->num) + channels->num) % channels->num];
+}
+
+
+/* CHANNEL.SEND: sends top of CODE to channel with id from top of INT */
+static void push_instr_channel_send(push_t *push, void *userdata) {
+  push_channels_t *channels = (push_channels_t*)userdata;
+  push_val_t *val1, *val2;
+
+  if (push_stack_length(push->integer) >= 1 && push_stack_length(push->code) >= 1) {
+    val1 = push_stack_pop(push->integer);
+    val2 = push_stack_pop(push->code);
+
+    push_channel_send(push_channels_get(channels, val1->integer), val2);
+  }
+}
+
+
+/* CHANNEL.RECV: pushes the oldest value from channel with id from top of INT onto EXEC
+ * NOTE: Without a value the instruction is pushed back onto EXEC and the
+ *       process waits until something is sent (see push_vm_park).
+ */
+static void push_instr_channel_recv(push_t *push, void *userdata) {
+  push_channels_t *channels = (push_channels_t*)userdata;
+  push_channel_t *channel;
+  push_val_t *val;
+  gint signals;
+
+  if (push_stack_length(push->integer) >= 1) {
+    channel = push_channels_get(channels, push_stack_peek(push->integer)->integer);
+
+    /* NOTE: read signals first, so a value sent meanwhile wakes us up */
+    signals = g_atomic_int_get(&channel->waitq->signals);
+
+    val = push_channel_recv(channel, push);
+    if (val != NULL) {
+      push_stack_pop(push->integer);
+      push_stack_push(push->exec, val);
+    }
+    else {
+      push_stack_push_new(push, push->exec, PUSH_TYPE_INSTR, push_instr_lookup(push, "CHANNEL.RECV"));
+
+      if (push_channel_length(channel) > 0) {
+        /* another interpreter is taking a value, so just try again later */
+        push_vm_park(push, NULL, 0);
+      }
+      else {
+        push_vm_park(push, channel->waitq, signals);
+      }
+    }
+  }
+}
+
+
+/* Adds CHANNEL.SEND and CHANNEL.RECV for channels to push */
+void push_channels_reg(push_t *push, push_channels_t *channels) {
+  g_return_if_null(push);
+  g_return_if_null(channels);
+
+  push_instr_reg(push, "CHANNEL.SEND", push_instr_channel_send, channels);
+  push_instr_reg(push, "CHANNEL.RECV", push_instr_channel_recv, channels);
+}
@@ -25,6 +25,9 @@
 #include "push.h"
 
 
+#define PUSH_CODE_HASH_SEED         5381
+#define push_code_hash_step(h, x)   ((h) * 33 + (x))
+
 
 push_code_t *push_code_new(void) {
   return g_queue_new();
@@ -81,6 +84,68 @@ void push_code_foreach(push_code_t *code, GFunc func, void *userdata) {
 }
 
 
+/* Pre-order walk over all values in code (including values in sub-code)
+ * NOTE: Uses an explicit stack of links instead of recursion, so deeply
+ *       nested code can't overflow the C stack
+ */
+void push_code_walk_init(push_code_walk_t *walk, push_code_t *code) {
+  walk->code = code;
+  walk->link = NULL;
+  walk->path = g_ptr_array_new();
+  walk->skip = FALSE;
+}
+
+void push_code_walk_clear(push_code_walk_t *walk) {
+  g_ptr_array_free(walk->path, TRUE);
+}
+
+/* Don't descend into the value returned last */
+void push_code_walk_skip(push_code_walk_t *walk) {
+  walk->skip = TRUE;
+}
+
+/* Returns next value or NULL if the walk is done
+ * NOTE: walk->link is the link of the returned value and walk->path holds the
+ *       links of all code values containing it (outermost first)
+ */
+push_val_t *push_code_walk_next(push_code_walk_t *walk) {
+  GList *link = walk->link;
+  push_val_t *val;
+
+  if (link == NULL) {
+    /* first value */
+    link = walk->code != NULL ? walk->code->head : NULL;
+    walk->code = NULL;
+  }
+  else {
+    val = (push_val_t*)link->data;
+
+    if (push_check_code(val) && val->code->head != NULL && !walk->skip) {
+      /* descend on sub-code */
+      g_ptr_array_add(walk->path, link);
+      link = val->code->head;
+    }
+    else {
+      /* next value, ascend from finished sub-code */
+      link = link->next;
+      while (link == NULL && walk->path->len > 0) {
+        link = ((GList*)g_ptr_array_remove_index(walk->path, walk->path->len - 1))->next;
+      }
+    }
+  }
+
+  walk->link = link;
+  walk->skip = FALSE;
+
+  return link != NULL ? (push_val_t*)link->data : NULL;
+}
+
+/* Depth of the value returned last (0 for elements of the walked code) */
+int push_code_walk_depth(push_code_walk_t *walk) {
+  return walk->path->len;
+}
+
+
 /* duplicate code */
 push_code_t *push_code_dup_ext(push_code_t *code, GList *first_link, GList *last_link, GList *replace_link, push_val_t *replace_with) {
   push_code_t *new_code;
@@ -115,29 +180,58 @@ push_code_t *push_code_dup(push_code_t *code) {
 
 
 push_bool_t push_code_equal(push_code_t *code1, push_code_t *code2) {
-  GList *link1, *link2;
+  push_code_walk_t walk1, walk2;
+  push_val_t *val1, *val2;
+  push_bool_t equal = TRUE;
 
   g_return_val_if_null(code1, FALSE);
   g_return_val_if_null(code2, FALSE);
 
-  if (code1->length != code2->length) {
+  if (code1 == code2) {
+    return TRUE;
+  }
+  else if (code1->length != code2->length) {
     return FALSE;
   }
 
-  link1 = code1->head;
-  link2 = code2->head;
+  /* walk both in lock-step: same shape and equal atoms mean equal code */
+  push_code_walk_init(&walk1, code1);
+  push_code_walk_init(&walk2, code2);
+
+  do {
+    val1 = push_code_walk_next(&walk1);
+    val2 = push_code_walk_next(&walk2);
 
-  while (link1 != NULL && link2 != NULL) {
-    if (!push_val_equal(link1->data, link2->data)) {
-      return FALSE;
+    if (val1 == NULL || val2 == NULL) {
+      equal = val1 == val2;
     }
+    else if (val1 == val2) {
+      /* same value, no need to compare its sub-code */
+      push_code_walk_skip(&walk1);
+      push_code_walk_skip(&walk2);
+    }
+    else if (push_check_code(val1) && push_check_code(val2)) {
+      equal = val1->code->length == val2->code->length;
+    }
+    else {
+      equal = push_val_equal(val1, val2);
+    }
+  } while (equal && val1 != NULL);
+
+  push_code_walk_clear(&walk1);
+  push_code_walk_clear(&walk2);
+
+  return equal;
+}
 
-    link1 = link1->next;
-    link2 = link2->next;
-  }
 
-  return TRUE;
+static guint push_code_hash_ext(push_code_t *code, push_code_subtrees_t *index);
 
+/* Structural hash of code: equal code has equal hashes */
+guint push_code_hash(push_code_t *code) {
+  g_return_val_if_null(code, 0);
+
+  return push_code_hash_ext(code, NULL);
 }
 
 
@@ -182,100 +276,209 @@ push_code_t *push_code_concat(push_code_t *_code1, push_code_t *_code2) {
  *       ( A ) ) ( D ( A ) ) )" and the second piece of code is "( A )" then
  *       this pushes ( C ( A ) ). Pushes an empty list if there is no such
  *       container. 
+ *
+ * The search is done with an index of structural hashes (see
+ * push_code_subtrees_new), so needle is only compared to values that could be
+ * equal to it.
  */
-struct push_code_container_args {
-  push_val_t *needle;
-  push_code_t *finger;
+struct push_code_hash_frame {
+  /* code being hashed and its value (NULL for the outermost code) */
+  push_code_t *code;
+  push_val_t *val;
+
+  /* where val is in the outermost code */
+  push_code_t *container;
+  int preorder;
+
+  /* next element to hash and hash so far */
+  GList *link;
+  guint hash;
 };
-static push_code_t *push_code_container_finger(push_code_t *haystack, push_val_t *needle);
 
-static int push_code_container_find(push_val_t *val, struct push_code_container_args *args) {
-  push_val_t *needle = args->needle;
-  push_code_t *finger;
+struct push_code_subtree {
+  /* value and the code it's an element of */
+  push_val_t *val;
+  push_code_t *container;
 
-  g_return_val_if_null(val, 1);
+  /* position of val in a pre-order walk */
+  int preorder;
 
-  if (push_val_equal(val, args->needle)) {
-    /* found needle, stop search so push_code_container_finger can return the finger */
-    return 0;
-  }
-  else if (push_check_code(val)) {
-    // this is a sub-code, search it
-    finger = push_code_container(val->code, needle);
-    if (finger != NULL) {
-      /* recursive call found container, pass finger and stop search */
-      args->finger = finger;
-      return 0;
+  /* index of next entry with same hash or -1 */
+  int next;
+};
+
+static void push_code_subtrees_add(push_code_subtrees_t *index, push_val_t *val, push_code_t *container, int preorder, guint hash) {
+  struct push_code_subtree entry;
+
+  entry.val = val;
+  entry.container = container;
+  entry.preorder = preorder;
+
+  /* prepend entry to chain of its hash */
+  entry.next = GPOINTER_TO_INT(g_hash_table_lookup(index->heads, GUINT_TO_POINTER(hash))) - 1;
+  g_array_append_val(index->entries, entry);
+  g_hash_table_insert(index->heads, GUINT_TO_POINTER(hash), GINT_TO_POINTER(index->entries->len));
+}
+
+
+/* Hash code bottom-up with an explicit stack of frames and add all sub-values
+ * to index (if not NULL)
+ */
+static guint push_code_hash_ext(push_code_t *code, push_code_subtrees_t *index) {
+  GArray *frames;
+  struct push_code_hash_frame frame, *top;
+  push_val_t *val;
+  guint hash;
+  int preorder = 0;
+
+  frames = g_array_new(FALSE, FALSE, sizeof(struct push_code_hash_frame));
+
+  frame.code = code;
+  frame.val = NULL;
+  frame.container = NULL;
+  frame.preorder = -1;
+  frame.link = code->head;
+  frame.hash = PUSH_CODE_HASH_SEED;
+  g_array_append_val(frames, frame);
+
+  while (TRUE) {
+    top = &g_array_index(frames, struct push_code_hash_frame, frames->len - 1);
+
+    if (top->link == NULL) {
+      /* sub-code done, add its hash to the containing code */
+      frame = *top;
+      g_array_set_size(frames, frames->len - 1);
+
+      if (frames->len == 0) {
+        break;
+      }
+
+      if (index != NULL) {
+        push_code_subtrees_add(index, frame.val, frame.container, frame.preorder, frame.hash);
+      }
+
+      top = &g_array_index(frames, struct push_code_hash_frame, frames->len - 1);
+      top->hash = push_code_hash_step(top->hash, frame.hash);
+    }
+    else {
+      val = (push_val_t*)top->link->data;
+      top->link = top->link->next;
+
+      if (push_check_code(val)) {
+        /* descend on sub-code */
+        frame.code = val->code;
+        frame.val = val;
+        frame.container = top->code;
+        frame.preorder = preorder++;
+        frame.link = val->code->head;
+        frame.hash = PUSH_CODE_HASH_SEED;
+        g_array_append_val(frames, frame);
+      }
+      else {
+        hash = push_val_hash(val);
+
+        if (index != NULL) {
+          push_code_subtrees_add(index, val, top->code, preorder, hash);
+        }
+        preorder++;
+
+        top->hash = push_code_hash_step(top->hash, hash);
+      }
     }
   }
 
-  /* nothing found, go to next element */
-  return 1;
+  g_array_free(frames, TRUE);
+
+  return frame.hash;
 }
 
-push_code_t *push_code_container(push_code_t *haystack, push_val_t *needle) {
-  struct push_code_container_args args = {
-    .needle = needle,
-    .finger = haystack
-  };
 
-  if (g_queue_find_custom(haystack, &args, (GCompareFunc)push_code_container_find) != NULL) {
-    return args.finger;
-  }
-  else {
-    return NULL;
-  }
+/* Build index of all sub-values in code by their structural hash
+ * NOTE: code must not be changed while the index is in use
+ */
+push_code_subtrees_t *push_code_subtrees_new(push_code_t *code) {
+  push_code_subtrees_t *index;
+
+  g_return_val_if_null(code, NULL);
+
+  index = g_slice_new(push_code_subtrees_t);
+  index->heads = g_hash_table_new(NULL, NULL);
+  index->entries = g_array_new(FALSE, FALSE, sizeof(struct push_code_subtree));
+
+  push_code_hash_ext(code, index);
+
+  return index;
 }
 
 
-/* Calculate discrepancy of both lists */
-int push_code_discrepancy(push_code_t *code1, push_code_t *code2) {
-  // TODO
-  return 0;
+void push_code_subtrees_destroy(push_code_subtrees_t *index) {
+  g_return_if_null(index);
+
+  g_hash_table_destroy(index->heads);
+  g_array_free(index->entries, TRUE);
+  g_slice_free(push_code_subtrees_t, index);
 }
 
 
-/* removes element indexed by point from code and returns it */
-struct push_code_extract_args {
-  int point;
-  push_val_t *val;
-};
+/* Returns the code containing the first (pre-order) value equal to needle
+ * NOTE: Only values with needle's hash are compared structurally
+ */
+push_code_t *push_code_subtrees_container(push_code_subtrees_t *index, push_val_t *needle) {
+  struct push_code_subtree *entry, *found = NULL;
+  int i;
 
-static int push_code_extract_find(push_val_t *val, struct push_code_extract_args *args) {
-  g_return_val_if_null(val, 0);
+  g_return_val_if_null(index, NULL);
+  g_return_val_if_null(needle, NULL);
 
-  if (args->point == 0) {
-    /* found element, return it */
-    args->val = val;
-    return 0;
-  }
-  else if (push_check_code(val)) {
-    args->point--;
+  i = GPOINTER_TO_INT(g_hash_table_lookup(index->heads, GUINT_TO_POINTER(push_val_hash(needle)))) - 1;
 
-    /* descend on sub-code */
-    if (g_queue_find_custom(val->code, args, (GCompareFunc)push_code_extract_find) != NULL) {
-      /* found element in sub-code, return it */
-      return 0;
+  for (; i >= 0; i = entry->next) {
+    entry = &g_array_index(index->entries, struct push_code_subtree, i);
+
+    if ((found == NULL || entry->preorder < found->preorder) && push_val_equal(entry->val, needle)) {
+      found = entry;
     }
   }
-  else {
-    args->point--;
-  }
 
-  return 1;
+  return found != NULL ? found->container : NULL;
+}
+
+
+push_code_t *push_code_container(push_code_t *haystack, push_val_t *needle) {
+  push_code_subtrees_t *index;
+  push_code_t *container;
+
+  g_return_val_if_null(haystack, NULL);
+
+  index = push_code_subtrees_new(haystack);
+  container = push_code_subtrees_container(index, needle);
+  push_code_subtrees_destroy(index);
+
+  return container;
+}
+
+
+/* Calculate discrepancy of both lists */
+int push_code_discrepancy(push_code_t *code1, push_code_t *code2) {
+  // TODO
+  return 0;
 }
 
+
+/* returns element indexed by point (pre-order, 0 is first element of code) */
 push_val_t *push_code_extract(push_code_t *code, push_int_t point) {
-  struct push_code_extract_args args = {
-    .point = point,
-    .val = NULL
-  };
+  push_code_walk_t walk;
+  push_val_t *val;
 
   g_return_val_if_fail(point >= 0, NULL);
 
-  g_queue_find_custom(code, &args, (GCompareFunc)push_code_extract_find);
+  push_code_walk_init(&walk, code);
+  while ((val = push_code_walk_next(&walk)) != NULL && point > 0) {
+    point--;
+  }
+  push_code_walk_clear(&walk);
 
-  return args.val;
+  return val;
 }
 
 
@@ -311,67 +514,28 @@ int push_code_index(push_code_t *haystack, push_val_t *needle) {
 
 
 /* returns size ("number of points") */
-static void push_code_size_iter(push_val_t *val, int *size) {
-  g_return_if_null(val);
-
-  *size += 1;
-  if (push_check_code(val)) {
-    g_queue_foreach(val->code, (GFunc)push_code_size_iter, size);
-  }
-}
-
 int push_code_size(push_code_t *code) {
+  push_code_walk_t walk;
   int size = 0;
 
-  g_queue_foreach(code, (GFunc)push_code_size_iter, &size);
+  push_code_walk_init(&walk, code);
+  while (push_code_walk_next(&walk) != NULL) {
+    size++;
+  }
+  push_code_walk_clear(&walk);
 
   return size;
 }
 
 
-/* insert element */
-struct push_code_replace_args {
-  push_t *push;
-  push_int_t point;
-  push_val_t *val;
-};
-
-static int push_code_replace_find(push_val_t *val, struct push_code_replace_args *args) {
-  GList *link;
-
-  g_return_val_if_null(val, 0);
-
-  if (args->point == 0) {
-    /* found element, return */
-    return 0;
-  }
-  else if (push_check_code(val)) {
-    args->point--;
-
-    /* descend on sub-code */
-    link = g_queue_find_custom(val->code, args, (GCompareFunc)push_code_replace_find);
-
-    if (link != NULL) {
-      /* found element in sub-code, copy code and replace element */
-      args->val = push_val_new(args->push, PUSH_TYPE_CODE, push_code_dup_ext(val->code, NULL, NULL, link, args->val));
-      
-      return 0;
-    }
-  }
-  else {
-    args->point--;
-  }
-
-  return 1;
-}
-
+/* replace element indexed by point (point 0 is code itself) with val
+ * NOTE: returns new code value, code itself is not changed
+ */
 push_val_t *push_code_replace(push_t *push, push_code_t *code, push_int_t point, push_val_t *val) {
-  struct push_code_replace_args args = {
-    .push = push,
-    .point = point - 1,
-    .val = val
-  };
+  push_code_walk_t walk;
+  push_val_t *found;
   GList *link;
+  int i;
 
   g_return_val_if_null(val, NULL);
   g_return_val_if_fail(point >= 0, NULL);
@@ -381,15 +545,31 @@ push_val_t *push_code_replace(push_t *push, push_code_t *code, push_int_t point,
     return val;
   }
 
-  link = g_queue_find_custom(code, &args, (GCompareFunc)push_code_replace_find);
+  /* find element, walk.path then holds the code values containing it */
+  push_code_walk_init(&walk, code);
+  while ((found = push_code_walk_next(&walk)) != NULL && point > 1) {
+    point--;
+  }
+
+  if (found != NULL) {
+    /* copy containing code values from the inside out and replace element */
+    link = walk.link;
+    for (i = walk.path->len - 1; i >= 0; i--) {
+      found = (push_val_t*)((GList*)g_ptr_array_index(walk.path, i))->data;
+      val = push_val_new(push, PUSH_TYPE_CODE, push_code_dup_ext(found->code, NULL, NULL, link, val));
+      link = (GList*)g_ptr_array_index(walk.path, i);
+    }
 
-  if (link != NULL) {
     /* return new (code) value */
-    return push_val_new(push, PUSH_TYPE_CODE, push_code_dup_ext(code, NULL, NULL, link, args.val));
+    val = push_val_new(push, PUSH_TYPE_CODE, push_code_dup_ext(code, NULL, NULL, link, val));
   }
   else {
-    return NULL;
+    val = NULL;
   }
+
+  push_code_walk_clear(&walk);
+
+  return val;
 }
 
 
@@ -24,6 +24,7 @@
 
 #include <stddef.h>
 #include <math.h>
+#include <string.h>
 
 #include <glib.h>
 
@@ -36,8 +37,27 @@
 /* check if stack has enough items */
 #define CH(stack, num)         (push_stack_length(stack) >= num)
 
-/* define which stack to use for a POLY instruction */
-#define STACK(stack)           offsetof(push_t, stack)
+/* define instruction func, that calls func_unchecked if cond holds
+ * NOTE: superinstructions call func_unchecked directly, after checking the
+ *       stack effect of all parts at once (see push_dis_effects)
+ */
+#define CHECKED(func, cond) \
+  static void func(push_t *push, void *userdata) { \
+    if (cond) { \
+      func##_unchecked(push, userdata); \
+    } \
+  }
+#define CHECKED_POLY(func, cond) \
+  static void func(push_t *push, push_stack_t *stack) { \
+    if (cond) { \
+      func##_unchecked(push, stack); \
+    } \
+  }
+
+/* define which stack to use for a POLY instruction
+ * NOTE: this also marks the entry as POLY, since the offset can be 0
+ */
+#define STACK(stack)           TRUE, offsetof(push_t, stack)
 #define GETSTACK(push, offset) G_STRUCT_MEMBER(push_stack_t*, push, offset)
 
 
@@ -47,6 +67,8 @@
 struct push_dis_S {
   const char *name;
   void *func;
+  /* whether stack is used (see STACK) */
+  push_bool_t poly;
   /* actually offset of stack pointer in push structure */
   long stack;
 };
@@ -56,15 +78,14 @@ struct push_dis_S {
 /* POLY
  * NOTE: polymorph instructions (e.g. DUP). stack is passed as userdata
  */
-static void push_instr_poly_equal(push_t *push, push_stack_t *stack) {
+static void push_instr_poly_equal_unchecked(push_t *push, push_stack_t *stack) {
   push_val_t *val1, *val2;
 
-  if (CH(stack, 2)) {
-    val1 = push_stack_pop(stack);
-    val2 = push_stack_pop(stack);
-    push_stack_push_new(push, push->boolean, PUSH_TYPE_BOOL, push_val_equal(val1, val2));
-  }
+  val1 = push_stack_pop(stack);
+  val2 = push_stack_pop(stack);
+  push_stack_push_new(push, push->boolean, PUSH_TYPE_BOOL, push_val_equal(val1, val2));
 }
+CHECKED_POLY(push_instr_poly_equal, CH(stack, 2))
 
 static void push_instr_poly_define(push_t *push, push_stack_t *stack) {
   push_val_t *val1, *val2;
@@ -76,32 +97,28 @@ static void push_instr_poly_define(push_t *push, push_stack_t *stack) {
   }
 }
 
-static void push_instr_poly_dup(push_t *push, push_stack_t *stack) {
-  push_val_t *val1;
-
-  val1 = push_stack_peek(stack);
-  if (val1 != NULL) {
-    //push_stack_push_dup(push, stack, val1);
-    push_stack_push(stack, val1);
-  }
+static void push_instr_poly_dup_unchecked(push_t *push, push_stack_t *stack) {
+  //push_stack_push_dup(push, stack, push_stack_peek(stack));
+  push_stack_push(stack, push_stack_peek(stack));
 }
+CHECKED_POLY(push_instr_poly_dup, CH(stack, 1))
 
 static void push_instr_poly_flush(push_t *push, push_stack_t *stack) {
   push_stack_flush(stack);
 }
 
-static void push_instr_poly_pop(push_t *push, push_stack_t *stack) {
+static void push_instr_poly_pop_unchecked(push_t *push, push_stack_t *stack) {
   push_stack_pop(stack);
 }
+CHECKED_POLY(push_instr_poly_pop, CH(stack, 1))
 
-static void push_instr_poly_rot(push_t *push, push_stack_t *stack) {
+static void push_instr_poly_rot_unchecked(push_t *push, push_stack_t *stack) {
   push_val_t *val1;
 
-  if (CH(stack, 3)) {
-    val1 = push_stack_pop_nth(stack, 2);
-    push_stack_push(stack, val1);
-  }
+  val1 = push_stack_pop_nth(stack, 2);
+  push_stack_push(stack, val1);
 }
+CHECKED_POLY(push_instr_poly_rot, CH(stack, 3))
 
 static void push_instr_poly_shove(push_t *push, push_stack_t *stack) {
   push_val_t *val1, *val2;
@@ -118,14 +135,13 @@ static void push_instr_poly_stackdepth(push_t *push, push_stack_t *stack) {
   push_stack_push_new(push, push->integer, PUSH_TYPE_INT, push_stack_length(stack));
 }
 
-static void push_instr_poly_swap(push_t *push, push_stack_t *stack) {
+static void push_instr_poly_swap_unchecked(push_t *push, push_stack_t *stack) {
   push_val_t *val1;
 
-  if (CH(stack, 2)) {
-    val1 = push_stack_pop(stack);
-    push_stack_push_nth(stack, 1, val1);
-  }
+  val1 = push_stack_pop(stack);
+  push_stack_push_nth(stack, 1, val1);
 }
+CHECKED_POLY(push_instr_poly_swap, CH(stack, 2))
 
 static void push_instr_poly_yank(push_t *push, push_stack_t *stack) {
   push_val_t *val1, *val2;
@@ -163,52 +179,47 @@ static void push_instr_poly_yankdup(push_t *push, push_stack_t *stack) {
 
 
 /* BOOL */
-static void push_instr_bool_and(push_t *push, void *userdata) {
+static void push_instr_bool_and_unchecked(push_t *push, void *userdata) {
   push_val_t *val1, *val2;
 
-  if (CH(push->boolean, 2)) {
-    val1 = push_stack_pop(push->boolean);
-    val2 = push_stack_pop(push->boolean);
-    push_stack_push_new(push, push->boolean, PUSH_TYPE_BOOL, val1->boolean && val2->boolean);
-  }
+  val1 = push_stack_pop(push->boolean);
+  val2 = push_stack_pop(push->boolean);
+  push_stack_push_new(push, push->boolean, PUSH_TYPE_BOOL, val1->boolean && val2->boolean);
 }
+CHECKED(push_instr_bool_and, CH(push->boolean, 2))
 
-static void push_instr_bool_fromint(push_t *push, void *userdata) {
+static void push_instr_bool_fromint_unchecked(push_t *push, void *userdata) {
   push_val_t *val1;
 
-  if (CH(push->integer, 1)) {
-    val1 = push_stack_pop(push->integer);
-    push_stack_push_new(push, push->boolean, PUSH_TYPE_BOOL, val1->integer != 0);
-  }
+  val1 = push_stack_pop(push->integer);
+  push_stack_push_new(push, push->boolean, PUSH_TYPE_BOOL, val1->integer != 0);
 }
+CHECKED(push_instr_bool_fromint, CH(push->integer, 1))
 
-static void push_instr_bool_fromreal(push_t *push, void *userdata) {
+static void push_instr_bool_fromreal_unchecked(push_t *push, void *userdata) {
   push_val_t *val1;
 
-  if (CH(push->real, 1)) {
-    val1 = push_stack_pop(push->real);
-    push_stack_push_new(push, push->boolean, PUSH_TYPE_BOOL, val1->real != 0.0);
-  }
+  val1 = push_stack_pop(push->real);
+  push_stack_push_new(push, push->boolean, PUSH_TYPE_BOOL, val1->real != 0.0);
 }
+CHECKED(push_instr_bool_fromreal, CH(push->real, 1))
 
-static void push_instr_bool_not(push_t *push, void *userdata) {
+static void push_instr_bool_not_unchecked(push_t *push, void *userdata) {
   push_val_t *val1;
 
   val1 = push_stack_pop(push->boolean);
-  if (val1 != NULL) {
-    push_stack_push_new(push, push->boolean, PUSH_TYPE_BOOL, !val1->boolean);
-  }
+  push_stack_push_new(push, push->boolean, PUSH_TYPE_BOOL, !val1->boolean);
 }
+CHECKED(push_instr_bool_not, CH(push->boolean, 1))
 
-static void push_instr_bool_or(push_t *push, void *userdata) {
+static void push_instr_bool_or_unchecked(push_t *push, void *userdata) {
   push_val_t *val1, *val2;
 
-  if (CH(push->boolean, 2)) {
-    val1 = push_stack_pop(push->boolean);
-    val2 = push_stack_pop(push->boolean);
-    push_stack_push_new(push, push->boolean, PUSH_TYPE_BOOL, val1->boolean || val2->boolean);
-  }
+  val1 = push_stack_pop(push->boolean);
+  val2 = push_stack_pop(push->boolean);
+  push_stack_push_new(push, push->boolean, PUSH_TYPE_BOOL, val1->boolean || val2->boolean);
 }
+CHECKED(push_instr_bool_or, CH(push->boolean, 2))
 
 static void push_instr_bool_rand(push_t *push, void *userdata) {
   push_stack_push(push->boolean, push_rand_val(push, PUSH_TYPE_BOOL, NULL, FALSE));
@@ -366,8 +377,7 @@ static void push_instr_code_do_count(push_t *push, void *userdata) {
       /* construct ( 0 <1 - IntegerArg> CODE.QUOTE <CodeArg> CODE.DO*RANGE ) */
       code = push_code_new();
       push_code_append(code, push_val_new(push, PUSH_TYPE_INT, 0));
-      val2->integer = 1 - val2->integer;
-      push_code_append(code, val2);
+      push_code_append(code, push_val_new(push, PUSH_TYPE_INT, 1 - val2->integer));
       push_code_append(code, push_val_new(push, PUSH_TYPE_INSTR, push_instr_lookup(push, "CODE.QUOTE")));
       push_code_append(code, val1);
       push_code_append(code, push_val_new(push, PUSH_TYPE_INSTR, push_instr_lookup(push, "CODE.DO*RANGE")));
@@ -522,14 +532,18 @@ static void push_instr_code_insert(push_t *push, void *userdata) {
 
 static void push_instr_code_instructions(push_t *push, void *userdata) {
   push_code_t *list;
-  GHashTableIter iter;
   push_instr_t *instr;
+  push_int_t i, n;
 
   list = push_code_new();
-  g_hash_table_iter_init(&iter, push->instructions);
+  n = push_instrset_length(push->instructions);
 
-  while (g_hash_table_iter_next(&iter, NULL, (void*)&instr)) {
-    push_code_append(list, push_val_new(push, PUSH_TYPE_INSTR, instr));
+  /* in opcode order, without superinstructions */
+  for (i = 0; i < n; i++) {
+    instr = push_instrset_get(push->instructions, i);
+    if (instr != NULL && instr->parts == NULL) {
+      push_code_append(list, push_val_new(push, PUSH_TYPE_INSTR, instr));
+    }
   }
 
   push_stack_push_new(push, push->code, PUSH_TYPE_CODE, list);
@@ -583,7 +597,7 @@ static void push_instr_code_nth(push_t *push, void *userdata) {
     val2 = push_stack_pop_code(push);
 
     if (val2->code->length > 0) {
-      push_stack_push(push->code, push_code_pop_nth(val2->code, MOD(val1->integer, val2->code->length)));
+      push_stack_push(push->code, push_code_peek_nth(val2->code, MOD(val1->integer, val2->code->length)));
     }
   }
 }
@@ -685,8 +699,7 @@ static void push_instr_exec_do_count(push_t *push, void *userdata) {
       /* construct ( 0 <1 - IntegerArg> EXEC.DO*RANGE <ExecArg> ) */
       code = push_code_new();
       push_code_append(code, push_val_new(push, PUSH_TYPE_INT, 0));
-      val2->integer = 1 - val2->integer;
-      push_code_append(code, val2);
+      push_code_append(code, push_val_new(push, PUSH_TYPE_INT, 1 - val2->integer));
       push_code_append(code, push_val_new(push, PUSH_TYPE_INSTR, push_instr_lookup(push, "EXEC.DO*RANGE")));
       push_code_append(code, val1);
 
@@ -798,128 +811,115 @@ static void push_instr_exec_y(push_t *push, void *userdata) {
 
 /* INT */
 
-static void push_instr_int_mod(push_t *push, void *userdata) {
+static void push_instr_int_mod_unchecked(push_t *push, void *userdata) {
   push_val_t *val1, *val2;
 
-  if (CH(push->integer, 2)) {
-    val1 = push_stack_pop(push->integer);
-    val2 = push_stack_pop(push->integer);
+  val1 = push_stack_pop(push->integer);
+  val2 = push_stack_pop(push->integer);
 
-    if (val1->integer != 0) {
-      push_stack_push_new(push, push->integer, PUSH_TYPE_INT, MOD(val2->integer, val1->integer));
-    }
+  if (val1->integer != 0) {
+    push_stack_push_new(push, push->integer, PUSH_TYPE_INT, MOD(val2->integer, val1->integer));
   }
 }
+CHECKED(push_instr_int_mod, CH(push->integer, 2))
 
-static void push_instr_int_mul(push_t *push, void *userdata) {
+static void push_instr_int_mul_unchecked(push_t *push, void *userdata) {
   push_val_t *val1, *val2;
 
-  if (CH(push->integer, 2)) {
-    val1 = push_stack_pop(push->integer);
-    val2 = push_stack_pop(push->integer);
+  val1 = push_stack_pop(push->integer);
+  val2 = push_stack_pop(push->integer);
 
-    push_stack_push_new(push, push->integer, PUSH_TYPE_INT, val2->integer * val1->integer);
-  }
+  push_stack_push_new(push, push->integer, PUSH_TYPE_INT, val2->integer * val1->integer);
 }
+CHECKED(push_instr_int_mul, CH(push->integer, 2))
 
-static void push_instr_int_add(push_t *push, void *userdata) {
+static void push_instr_int_add_unchecked(push_t *push, void *userdata) {
   push_val_t *val1, *val2;
 
-  if (CH(push->integer, 2)) {
-    val1 = push_stack_pop(push->integer);
-    val2 = push_stack_pop(push->integer);
+  val1 = push_stack_pop(push->integer);
+  val2 = push_stack_pop(push->integer);
 
-    push_stack_push_new(push, push->integer, PUSH_TYPE_INT, val2->integer + val1->integer);
-  }
+  push_stack_push_new(push, push->integer, PUSH_TYPE_INT, val2->integer + val1->integer);
 }
+CHECKED(push_instr_int_add, CH(push->integer, 2))
 
-static void push_instr_int_sub(push_t *push, void *userdata) {
+static void push_instr_int_sub_unchecked(push_t *push, void *userdata) {
   push_val_t *val1, *val2;
 
-  if (CH(push->integer, 2)) {
-    val1 = push_stack_pop(push->integer);
-    val2 = push_stack_pop(push->integer);
+  val1 = push_stack_pop(push->integer);
+  val2 = push_stack_pop(push->integer);
 
-    push_stack_push_new(push, push->integer, PUSH_TYPE_INT, val2->integer - val1->integer);
-  }
+  push_stack_push_new(push, push->integer, PUSH_TYPE_INT, val2->integer - val1->integer);
 }
+CHECKED(push_instr_int_sub, CH(push->integer, 2))
 
-static void push_instr_int_div(push_t *push, void *userdata) {
+static void push_instr_int_div_unchecked(push_t *push, void *userdata) {
   push_val_t *val1, *val2;
 
-  if (CH(push->integer, 2)) {
-    val1 = push_stack_pop(push->integer);
-    val2 = push_stack_pop(push->integer);
+  val1 = push_stack_pop(push->integer);
+  val2 = push_stack_pop(push->integer);
 
-    if (val1->integer != 0) {
-      push_stack_push_new(push, push->integer, PUSH_TYPE_INT, val2->integer / val1->integer);
-    }
+  if (val1->integer != 0) {
+    push_stack_push_new(push, push->integer, PUSH_TYPE_INT, val2->integer / val1->integer);
   }
 }
+CHECKED(push_instr_int_div, CH(push->integer, 2))
 
-static void push_instr_int_less(push_t *push, void *userdata) {
+static void push_instr_int_less_unchecked(push_t *push, void *userdata) {
   push_val_t *val1, *val2;
 
-  if (CH(push->integer, 2)) {
-    val1 = push_stack_pop(push->integer);
-    val2 = push_stack_pop(push->integer);
+  val1 = push_stack_pop(push->integer);
+  val2 = push_stack_pop(push->integer);
 
-    push_stack_push_new(push, push->boolean, PUSH_TYPE_BOOL, val2->integer < val1->integer);
-  }
+  push_stack_push_new(push, push->boolean, PUSH_TYPE_BOOL, val2->integer < val1->integer);
 }
+CHECKED(push_instr_int_less, CH(push->integer, 2))
 
-static void push_instr_int_greater(push_t *push, void *userdata) {
+static void push_instr_int_greater_unchecked(push_t *push, void *userdata) {
   push_val_t *val1, *val2;
 
-  if (CH(push->integer, 2)) {
-    val1 = push_stack_pop(push->integer);
-    val2 = push_stack_pop(push->integer);
+  val1 = push_stack_pop(push->integer);
+  val2 = push_stack_pop(push->integer);
 
-    push_stack_push_new(push, push->boolean, PUSH_TYPE_BOOL, val2->integer > val1->integer);
-  }
+  push_stack_push_new(push, push->boolean, PUSH_TYPE_BOOL, val2->integer > val1->integer);
 }
+CHECKED(push_instr_int_greater, CH(push->integer, 2))
 
-static void push_instr_int_frombool(push_t *push, void *userdata) {
+static void push_instr_int_frombool_unchecked(push_t *push, void *userdata) {
   push_val_t *val1;
 
   val1 = push_stack_pop(push->boolean);
-
-  if (val1 != NULL) {
-    push_stack_push_new(push, push->integer, PUSH_TYPE_INT, val1->boolean ? 1 : 0);
-  }
+  push_stack_push_new(push, push->integer, PUSH_TYPE_INT, val1->boolean ? 1 : 0);
 }
+CHECKED(push_instr_int_frombool, CH(push->boolean, 1))
 
-static void push_instr_int_fromreal(push_t *push, void *userdata) {
+static void push_instr_int_fromreal_unchecked(push_t *push, void *userdata) {
   push_val_t *val1;
 
   val1 = push_stack_pop(push->real);
-
-  if (val1 != NULL) {
-    push_stack_push_new(push, push->integer, PUSH_TYPE_INT, (push_int_t)val1->real);
-  }
+  push_stack_push_new(push, push->integer, PUSH_TYPE_INT, (push_int_t)val1->real);
 }
+CHECKED(push_instr_int_fromreal, CH(push->real, 1))
 
-static void push_instr_int_max(push_t *push, void *userdata) {
+static void push_instr_int_max_unchecked(push_t *push, void *userdata) {
   push_val_t *val1, *val2;
 
-  if (CH(push->integer, 2)) {
-    val1 = push_stack_pop(push->integer);
-    val2 = push_stack_pop(push->integer);
+  val1 = push_stack_pop(push->integer);
+  val2 = push_stack_pop(push->integer);
 
-    push_stack_push(push->integer, push_val_max(val1, val2, integer));
-  }
+  push_stack_push(push->integer, push_val_max(val1, val2, integer));
 }
+CHECKED(push_instr_int_max, CH(push->integer, 2))
 
-static void push_instr_int_min(push_t *push, void *userdata) {
+static void push_instr_int_min_unchecked(push_t *push, void *userdata) {
   push_val_t *val1, *val2;
 
-  if (CH(push->integer, 2)) {
-    val1 = push_stack_pop(push->integer);
-    val2 = push_stack_pop(push->integer);
+  val1 = push_stack_pop(push->integer);
+  val2 = push_stack_pop(push->integer);
 
-    push_stack_push(push->integer, push_val_min(val1, val2, integer));
-  }
+  push_stack_push(push->integer, push_val_min(val1, val2, integer));
 }
+CHECKED(push_instr_int_min, CH(push->integer, 2))
 
 static void push_instr_int_rand(push_t *push, void *userdata) {
   push_stack_push(push->integer, push_rand_val(push, PUSH_TYPE_INT, NULL, FALSE));
@@ -951,86 +951,79 @@ static void push_instr_name_randboundname(push_t *push, void *userdata) {
 
 /* REAL */
 
-static void push_instr_real_mod(push_t *push, void *userdata) {
+static void push_instr_real_mod_unchecked(push_t *push, void *userdata) {
   push_val_t *val1, *val2;
 
-  if (CH(push->real, 2)) {
-    val1 = push_stack_pop(push->real);
-    val2 = push_stack_pop(push->real);
+  val1 = push_stack_pop(push->real);
+  val2 = push_stack_pop(push->real);
 
-    if (val2->real != 0.0) {
-      push_stack_push_new(push, push->real, PUSH_TYPE_REAL, fmod(val2->real, val1->real));
-    }
+  if (val2->real != 0.0) {
+    push_stack_push_new(push, push->real, PUSH_TYPE_REAL, fmod(val2->real, val1->real));
   }
 }
+CHECKED(push_instr_real_mod, CH(push->real, 2))
 
-static void push_instr_real_mul(push_t *push, void *userdata) {
+static void push_instr_real_mul_unchecked(push_t *push, void *userdata) {
   push_val_t *val1, *val2;
 
-  if (CH(push->real, 2)) {
-    val1 = push_stack_pop(push->real);
-    val2 = push_stack_pop(push->real);
+  val1 = push_stack_pop(push->real);
+  val2 = push_stack_pop(push->real);
 
-    push_stack_push_new(push, push->real, PUSH_TYPE_REAL, val2->real * val1->real);
-  }
+  push_stack_push_new(push, push->real, PUSH_TYPE_REAL, val2->real * val1->real);
 }
+CHECKED(push_instr_real_mul, CH(push->real, 2))
 
-static void push_instr_real_add(push_t *push, void *userdata) {
+static void push_instr_real_add_unchecked(push_t *push, void *userdata) {
   push_val_t *val1, *val2;
 
-  if (CH(push->real, 2)) {
-    val1 = push_stack_pop(push->real);
-    val2 = push_stack_pop(push->real);
+  val1 = push_stack_pop(push->real);
+  val2 = push_stack_pop(push->real);
 
-    push_stack_push_new(push, push->real, PUSH_TYPE_REAL, val2->real + val1->real);
-  }
+  push_stack_push_new(push, push->real, PUSH_TYPE_REAL, val2->real + val1->real);
 }
+CHECKED(push_instr_real_add, CH(push->real, 2))
 
-static void push_instr_real_sub(push_t *push, void *userdata) {
+static void push_instr_real_sub_unchecked(push_t *push, void *userdata) {
   push_val_t *val1, *val2;
 
-  if (CH(push->real, 2)) {
-    val1 = push_stack_pop(push->real);
-    val2 = push_stack_pop(push->real);
+  val1 = push_stack_pop(push->real);
+  val2 = push_stack_pop(push->real);
 
-    push_stack_push_new(push, push->real, PUSH_TYPE_REAL, val2->real - val1->real);
-  }
+  push_stack_push_new(push, push->real, PUSH_TYPE_REAL, val2->real - val1->real);
 }
+CHECKED(push_instr_real_sub, CH(push->real, 2))
 
-static void push_instr_real_div(push_t *push, void *userdata) {
+static void push_instr_real_div_unchecked(push_t *push, void *userdata) {
   push_val_t *val1, *val2;
 
-  if (CH(push->real, 2)) {
-    val1 = push_stack_pop(push->real);
-    val2 = push_stack_pop(push->real);
+  val1 = push_stack_pop(push->real);
+  val2 = push_stack_pop(push->real);
 
-    if (val2->real != 0.0) {
-      push_stack_push_new(push, push->real, PUSH_TYPE_REAL, val2->real / val1->real);
-    }
+  if (val2->real != 0.0) {
+    push_stack_push_new(push, push->real, PUSH_TYPE_REAL, val2->real / val1->real);
   }
 }
+CHECKED(push_instr_real_div, CH(push->real, 2))
 
-static void push_instr_real_less(push_t *push, void *userdata) {
+static void push_instr_real_less_unchecked(push_t *push, void *userdata) {
   push_val_t *val1, *val2;
 
-  if (CH(push->real, 2)) {
-    val1 = push_stack_pop(push->real);
-    val2 = push_stack_pop(push->real);
+  val1 = push_stack_pop(push->real);
+  val2 = push_stack_pop(push->real);
 
-    push_stack_push_new(push, push->boolean, PUSH_TYPE_BOOL, val2->real < val1->real);
-  }
+  push_stack_push_new(push, push->boolean, PUSH_TYPE_BOOL, val2->real < val1->real);
 }
+CHECKED(push_instr_real_less, CH(push->real, 2))
 
-static void push_instr_real_greater(push_t *push, void *userdata) {
+static void push_instr_real_greater_unchecked(push_t *push, void *userdata) {
   push_val_t *val1, *val2;
 
-  if (CH(push->real, 2)) {
-    val1 = push_stack_pop(push->real);
-    val2 = push_stack_pop(push->real);
+  val1 = push_stack_pop(push->real);
+  val2 = push_stack_pop(push->real);
 
-    push_stack_push_new(push, push->boolean, PUSH_TYPE_BOOL, val2->real > val1->real);
-  }
+  push_stack_push_new(push, push->boolean, PUSH_TYPE_BOOL, val2->real > val1->real);
 }
+CHECKED(push_instr_real_greater, CH(push->real, 2))
 
 static void push_instr_real_cos(push_t *push, void *userdata) {
   push_val_t *val1;
@@ -1052,25 +1045,21 @@ static void push_instr_real_exp(push_t *push, void *userdata) {
   }
 }
 
-static void push_instr_real_frombool(push_t *push, void *userdata) {
+static void push_instr_real_frombool_unchecked(push_t *push, void *userdata) {
   push_val_t *val1;
 
   val1 = push_stack_pop(push->boolean);
-
-  if (val1 != NULL) {
-    push_stack_push_new(push, push->real, PUSH_TYPE_REAL, val1->boolean ? 1.0 : 0.0);
-  }
+  push_stack_push_new(push, push->real, PUSH_TYPE_REAL, val1->boolean ? 1.0 : 0.0);
 }
+CHECKED(push_instr_real_frombool, CH(push->boolean, 1))
 
-static void push_instr_real_fromint(push_t *push, void *userdata) {
+static void push_instr_real_fromint_unchecked(push_t *push, void *userdata) {
   push_val_t *val1;
 
   val1 = push_stack_pop(push->integer);
-
-  if (val1 != NULL) {
-    push_stack_push_new(push, push->real, PUSH_TYPE_REAL, (push_real_t)val1->integer);
-  }
+  push_stack_push_new(push, push->real, PUSH_TYPE_REAL, (push_real_t)val1->integer);
 }
+CHECKED(push_instr_real_fromint, CH(push->integer, 1))
 
 static void push_instr_real_log(push_t *push, void *userdata) {
   push_val_t *val1;
@@ -1082,27 +1071,25 @@ static void push_instr_real_log(push_t *push, void *userdata) {
   }
 }
 
-static void push_instr_real_max(push_t *push, void *userdata) {
+static void push_instr_real_max_unchecked(push_t *push, void *userdata) {
   push_val_t *val1, *val2;
 
-  if (CH(push->real, 2)) {
-    val1 = push_stack_pop(push->real);
-    val2 = push_stack_pop(push->real);
+  val1 = push_stack_pop(push->real);
+  val2 = push_stack_pop(push->real);
 
-    push_stack_push(push->real, push_val_max(val1, val2, real));
-  }
+  push_stack_push(push->real, push_val_max(val1, val2, real));
 }
+CHECKED(push_instr_real_max, CH(push->real, 2))
 
-static void push_instr_real_min(push_t *push, void *userdata) {
+static void push_instr_real_min_unchecked(push_t *push, void *userdata) {
   push_val_t *val1, *val2;
 
-  if (CH(push->real, 2)) {
-    val1 = push_stack_pop(push->real);
-    val2 = push_stack_pop(push->real);
+  val1 = push_stack_pop(push->real);
+  val2 = push_stack_pop(push->real);
 
-    push_stack_push(push->real, push_val_min(val1, val2, real));
-  }
+  push_stack_push(push->real, push_val_min(val1, val2, real));
 }
+CHECKED(push_instr_real_min, CH(push->real, 2))
 
 static void push_instr_real_rand(push_t *push, void *userdata) {
   push_stack_push(push->real, push_rand_val(push, PUSH_TYPE_REAL, NULL, FALSE));
@@ -1129,6 +1116,431 @@ static void push_instr_real_tan(push_t *push, void *userdata) {
 }
 
 
+/* INTVEC & REALVEC
+ * NOTE: element-wise instructions use the length of the shorter vector
+ */
+
+typedef void (*push_vec_int_kernel_t)(push_int_t *dst, const push_int_t *a, const push_int_t *b, push_int_t n);
+typedef void (*push_vec_real_kernel_t)(push_real_t *dst, const push_real_t *a, const push_real_t *b, push_int_t n);
+
+static void push_instr_intvec_map2(push_t *push, push_vec_int_kernel_t kernel) {
+  push_val_t *val1, *val2;
+  push_vec_t *vec;
+  push_int_t n;
+
+  if (CH(push->intvec, 2)) {
+    val1 = push_stack_pop(push->intvec);
+    val2 = push_stack_pop(push->intvec);
+
+    n = MIN(val1->vec->len, val2->vec->len);
+    vec = push_vec_new_int(n);
+    kernel(push_vec_ints(vec), push_vec_ints(val2->vec), push_vec_ints(val1->vec), n);
+
+    push_stack_push_new(push, push->intvec, PUSH_TYPE_INTVEC, vec);
+  }
+}
+
+static void push_instr_realvec_map2(push_t *push, push_vec_real_kernel_t kernel) {
+  push_val_t *val1, *val2;
+  push_vec_t *vec;
+  push_int_t n;
+
+  if (CH(push->realvec, 2)) {
+    val1 = push_stack_pop(push->realvec);
+    val2 = push_stack_pop(push->realvec);
+
+    n = MIN(val1->vec->len, val2->vec->len);
+    vec = push_vec_new_real(n);
+    kernel(push_vec_reals(vec), push_vec_reals(val2->vec), push_vec_reals(val1->vec), n);
+
+    push_stack_push_new(push, push->realvec, PUSH_TYPE_REALVEC, vec);
+  }
+}
+
+static void push_instr_intvec_add(push_t *push, void *userdata) {
+  push_instr_intvec_map2(push, push_vec_int_add);
+}
+
+static void push_instr_intvec_sub(push_t *push, void *userdata) {
+  push_instr_intvec_map2(push, push_vec_int_sub);
+}
+
+static void push_instr_intvec_mul(push_t *push, void *userdata) {
+  push_instr_intvec_map2(push, push_vec_int_mul);
+}
+
+static void push_instr_realvec_add(push_t *push, void *userdata) {
+  push_instr_realvec_map2(push, push_vec_real_add);
+}
+
+static void push_instr_realvec_sub(push_t *push, void *userdata) {
+  push_instr_realvec_map2(push, push_vec_real_sub);
+}
+
+static void push_instr_realvec_mul(push_t *push, void *userdata) {
+  push_instr_realvec_map2(push, push_vec_real_mul);
+}
+
+static void push_instr_intvec_dot(push_t *push, void *userdata) {
+  push_val_t *val1, *val2;
+
+  if (CH(push->intvec, 2)) {
+    val1 = push_stack_pop(push->intvec);
+    val2 = push_stack_pop(push->intvec);
+
+    push_stack_push_new(push, push->integer, PUSH_TYPE_INT, push_vec_int_dot(push_vec_ints(val2->vec), push_vec_ints(val1->vec), MIN(val1->vec->len, val2->vec->len)));
+  }
+}
+
+static void push_instr_realvec_dot(push_t *push, void *userdata) {
+  push_val_t *val1, *val2;
+
+  if (CH(push->realvec, 2)) {
+    val1 = push_stack_pop(push->realvec);
+    val2 = push_stack_pop(push->realvec);
+
+    push_stack_push_new(push, push->real, PUSH_TYPE_REAL, push_vec_real_dot(push_vec_reals(val2->vec), push_vec_reals(val1->vec), MIN(val1->vec->len, val2->vec->len)));
+  }
+}
+
+static void push_instr_intvec_sum(push_t *push, void *userdata) {
+  push_val_t *val1;
+
+  val1 = push_stack_pop(push->intvec);
+
+  if (val1 != NULL) {
+    push_stack_push_new(push, push->integer, PUSH_TYPE_INT, push_vec_int_sum(push_vec_ints(val1->vec), val1->vec->len));
+  }
+}
+
+static void push_instr_realvec_sum(push_t *push, void *userdata) {
+  push_val_t *val1;
+
+  val1 = push_stack_pop(push->realvec);
+
+  if (val1 != NULL) {
+    push_stack_push_new(push, push->real, PUSH_TYPE_REAL, push_vec_real_sum(push_vec_reals(val1->vec), val1->vec->len));
+  }
+}
+
+static void push_instr_intvec_offset(push_t *push, void *userdata) {
+  push_val_t *val1, *val2;
+  push_vec_t *vec;
+
+  if (CH(push->intvec, 1) && CH(push->integer, 1)) {
+    val1 = push_stack_pop(push->integer);
+    val2 = push_stack_pop(push->intvec);
+
+    vec = push_vec_new_int(val2->vec->len);
+    push_vec_int_offset(push_vec_ints(vec), push_vec_ints(val2->vec), val1->integer, val2->vec->len);
+
+    push_stack_push_new(push, push->intvec, PUSH_TYPE_INTVEC, vec);
+  }
+}
+
+static void push_instr_intvec_scale(push_t *push, void *userdata) {
+  push_val_t *val1, *val2;
+  push_vec_t *vec;
+
+  if (CH(push->intvec, 1) && CH(push->integer, 1)) {
+    val1 = push_stack_pop(push->integer);
+    val2 = push_stack_pop(push->intvec);
+
+    vec = push_vec_new_int(val2->vec->len);
+    push_vec_int_scale(push_vec_ints(vec), push_vec_ints(val2->vec), val1->integer, val2->vec->len);
+
+    push_stack_push_new(push, push->intvec, PUSH_TYPE_INTVEC, vec);
+  }
+}
+
+static void push_instr_realvec_offset(push_t *push, void *userdata) {
+  push_val_t *val1, *val2;
+  push_vec_t *vec;
+
+  if (CH(push->realvec, 1) && CH(push->real, 1)) {
+    val1 = push_stack_pop(push->real);
+    val2 = push_stack_pop(push->realvec);
+
+    vec = push_vec_new_real(val2->vec->len);
+    push_vec_real_offset(push_vec_reals(vec), push_vec_reals(val2->vec), val1->real, val2->vec->len);
+
+    push_stack_push_new(push, push->realvec, PUSH_TYPE_REALVEC, vec);
+  }
+}
+
+static void push_instr_realvec_scale(push_t *push, void *userdata) {
+  push_val_t *val1, *val2;
+  push_vec_t *vec;
+
+  if (CH(push->realvec, 1) && CH(push->real, 1)) {
+    val1 = push_stack_pop(push->real);
+    val2 = push_stack_pop(push->realvec);
+
+    vec = push_vec_new_real(val2->vec->len);
+    push_vec_real_scale(push_vec_reals(vec), push_vec_reals(val2->vec), val1->real, val2->vec->len);
+
+    push_stack_push_new(push, push->realvec, PUSH_TYPE_REALVEC, vec);
+  }
+}
+
+/* POLY for vectors: stack is passed as userdata, type is taken from the value */
+
+static void push_instr_vec_slice(push_t *push, push_stack_t *stack) {
+  push_val_t *val1, *val2, *val3;
+
+  if (CH(stack, 1) && CH(push->integer, 2)) {
+    val1 = push_stack_pop(push->integer);
+    val2 = push_stack_pop(push->integer);
+    val3 = push_stack_pop(stack);
+
+    push_stack_push_new(push, stack, val3->type, push_vec_slice(val3->vec, MIN(val1->integer, val2->integer), MAX(val1->integer, val2->integer)));
+  }
+}
+
+static void push_instr_vec_length(push_t *push, push_stack_t *stack) {
+  push_val_t *val1;
+
+  val1 = push_stack_pop(stack);
+
+  if (val1 != NULL) {
+    push_stack_push_new(push, push->integer, PUSH_TYPE_INT, val1->vec->len);
+  }
+}
+
+static void push_instr_vec_empty(push_t *push, push_stack_t *stack) {
+  push_stack_push_new(push, stack, stack == push->intvec ? PUSH_TYPE_INTVEC : PUSH_TYPE_REALVEC, NULL);
+}
+
+static void push_instr_intvec_nth(push_t *push, void *userdata) {
+  push_val_t *val1, *val2;
+
+  if (CH(push->intvec, 1) && CH(push->integer, 1)) {
+    val1 = push_stack_pop(push->integer);
+    val2 = push_stack_pop(push->intvec);
+
+    if (val2->vec->len > 0) {
+      push_stack_push_new(push, push->integer, PUSH_TYPE_INT, push_vec_ints(val2->vec)[MOD(val1->integer, (push_int_t)val2->vec->len)]);
+    }
+  }
+}
+
+static void push_instr_realvec_nth(push_t *push, void *userdata) {
+  push_val_t *val1, *val2;
+
+  if (CH(push->realvec, 1) && CH(push->integer, 1)) {
+    val1 = push_stack_pop(push->integer);
+    val2 = push_stack_pop(push->realvec);
+
+    if (val2->vec->len > 0) {
+      push_stack_push_new(push, push->real, PUSH_TYPE_REAL, push_vec_reals(val2->vec)[MOD(val1->integer, (push_int_t)val2->vec->len)]);
+    }
+  }
+}
+
+static void push_instr_intvec_conj(push_t *push, void *userdata) {
+  push_val_t *val1, *val2;
+  push_vec_t *vec;
+
+  if (CH(push->intvec, 1) && CH(push->integer, 1)) {
+    val1 = push_stack_pop(push->integer);
+    val2 = push_stack_pop(push->intvec);
+
+    vec = push_vec_dup(val2->vec);
+    g_array_append_val(vec, val1->integer);
+
+    push_stack_push_new(push, push->intvec, PUSH_TYPE_INTVEC, vec);
+  }
+}
+
+static void push_instr_realvec_conj(push_t *push, void *userdata) {
+  push_val_t *val1, *val2;
+  push_vec_t *vec;
+
+  if (CH(push->realvec, 1) && CH(push->real, 1)) {
+    val1 = push_stack_pop(push->real);
+    val2 = push_stack_pop(push->realvec);
+
+    vec = push_vec_dup(val2->vec);
+    g_array_append_val(vec, val1->real);
+
+    push_stack_push_new(push, push->realvec, PUSH_TYPE_REALVEC, vec);
+  }
+}
+
+/* push all elements, so that the first one is on top */
+static void push_instr_intvec_pushall(push_t *push, void *userdata) {
+  push_val_t *val1;
+  push_int_t i;
+
+  val1 = push_stack_pop(push->intvec);
+
+  if (val1 != NULL) {
+    for (i = val1->vec->len - 1; i >= 0; i--) {
+      push_stack_push_new(push, push->integer, PUSH_TYPE_INT, push_vec_ints(val1->vec)[i]);
+    }
+  }
+}
+
+static void push_instr_realvec_pushall(push_t *push, void *userdata) {
+  push_val_t *val1;
+  push_int_t i;
+
+  val1 = push_stack_pop(push->realvec);
+
+  if (val1 != NULL) {
+    for (i = val1->vec->len - 1; i >= 0; i--) {
+      push_stack_push_new(push, push->real, PUSH_TYPE_REAL, push_vec_reals(val1->vec)[i]);
+    }
+  }
+}
+
+static void push_instr_intvec_fromrealvec(push_t *push, void *userdata) {
+  push_val_t *val1;
+  push_vec_t *vec;
+  guint i;
+
+  val1 = push_stack_pop(push->realvec);
+
+  if (val1 != NULL) {
+    vec = push_vec_new_int(val1->vec->len);
+    for (i = 0; i < val1->vec->len; i++) {
+      push_vec_ints(vec)[i] = (push_int_t)push_vec_reals(val1->vec)[i];
+    }
+
+    push_stack_push_new(push, push->intvec, PUSH_TYPE_INTVEC, vec);
+  }
+}
+
+static void push_instr_realvec_fromintvec(push_t *push, void *userdata) {
+  push_val_t *val1;
+  push_vec_t *vec;
+  guint i;
+
+  val1 = push_stack_pop(push->intvec);
+
+  if (val1 != NULL) {
+    vec = push_vec_new_real(val1->vec->len);
+    for (i = 0; i < val1->vec->len; i++) {
+      push_vec_reals(vec)[i] = (push_real_t)push_vec_ints(val1->vec)[i];
+    }
+
+    push_stack_push_new(push, push->realvec, PUSH_TYPE_REALVEC, vec);
+  }
+}
+
+
+/* STRING
+ * NOTE: results share the bytes of their arguments where possible
+ */
+
+static void push_instr_string_concat(push_t *push, void *userdata) {
+  push_val_t *val1, *val2;
+
+  if (CH(push->string, 2)) {
+    val1 = push_stack_pop(push->string);
+    val2 = push_stack_pop(push->string);
+
+    push_stack_push_new(push, push->string, PUSH_TYPE_STRING, push_str_concat(val2->str, val1->str));
+  }
+}
+
+static void push_instr_string_substring(push_t *push, void *userdata) {
+  push_val_t *val1, *val2, *val3;
+
+  if (CH(push->string, 1) && CH(push->integer, 2)) {
+    val1 = push_stack_pop(push->integer);
+    val2 = push_stack_pop(push->integer);
+    val3 = push_stack_pop(push->string);
+
+    push_stack_push_new(push, push->string, PUSH_TYPE_STRING, push_str_sub(val3->str, MIN(val1->integer, val2->integer), MAX(val1->integer, val2->integer)));
+  }
+}
+
+/* split at whitespace, so that the first word is on top */
+static void push_instr_string_split(push_t *push, void *userdata) {
+  push_val_t *val1;
+  push_int_t i, end;
+
+  val1 = push_stack_pop(push->string);
+
+  if (val1 != NULL) {
+    for (end = val1->str->length; end > 0; end = i) {
+      /* skip whitespace, then find start of word */
+      for (; end > 0 && g_ascii_isspace(val1->str->data[end - 1]); end--);
+      for (i = end; i > 0 && !g_ascii_isspace(val1->str->data[i - 1]); i--);
+
+      if (i < end) {
+        push_stack_push_new(push, push->string, PUSH_TYPE_STRING, push_str_sub(val1->str, i, end));
+      }
+    }
+  }
+}
+
+static void push_instr_string_length(push_t *push, void *userdata) {
+  push_val_t *val1;
+
+  val1 = push_stack_pop(push->string);
+
+  if (val1 != NULL) {
+    push_stack_push_new(push, push->integer, PUSH_TYPE_INT, val1->str->length);
+  }
+}
+
+static void push_instr_string_find(push_t *push, void *userdata) {
+  push_val_t *val1, *val2;
+
+  if (CH(push->string, 2)) {
+    val1 = push_stack_pop(push->string);
+    val2 = push_stack_pop(push->string);
+
+    push_stack_push_new(push, push->integer, PUSH_TYPE_INT, push_str_find(val2->str, val1->str));
+  }
+}
+
+static void push_instr_string_charat(push_t *push, void *userdata) {
+  push_val_t *val1, *val2;
+  push_int_t i;
+
+  if (CH(push->string, 1) && CH(push->integer, 1)) {
+    val1 = push_stack_pop(push->integer);
+    val2 = push_stack_pop(push->string);
+
+    if (val2->str->length > 0) {
+      i = MOD(val1->integer, val2->str->length);
+      push_stack_push_new(push, push->string, PUSH_TYPE_STRING, push_str_sub(val2->str, i, i + 1));
+    }
+  }
+}
+
+static void push_instr_string_emptystring(push_t *push, void *userdata) {
+  push_stack_push_new(push, push->string, PUSH_TYPE_STRING, NULL);
+}
+
+static void push_instr_string_fromint(push_t *push, void *userdata) {
+  push_val_t *val1;
+  char buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+  val1 = push_stack_pop(push->integer);
+
+  if (val1 != NULL) {
+    g_snprintf(buf, sizeof(buf), "%d", val1->integer);
+    push_stack_push_new(push, push->string, PUSH_TYPE_STRING, push_str_new(buf, -1));
+  }
+}
+
+static void push_instr_string_fromreal(push_t *push, void *userdata) {
+  push_val_t *val1;
+  char buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+  val1 = push_stack_pop(push->real);
+
+  if (val1 != NULL) {
+    g_ascii_dtostr(buf, sizeof(buf), val1->real);
+    push_stack_push_new(push, push->string, PUSH_TYPE_STRING, push_str_new(buf, -1));
+  }
+}
+
+
 /* Builtin default instruction set 
  */
 struct push_dis_S push_dis[] = {
@@ -1243,6 +1655,33 @@ struct push_dis_S push_dis[] = {
   { "INT.YANK",          push_instr_poly_yank          , STACK(integer)      },
   { "INT.YANKDUP",       push_instr_poly_yankdup       , STACK(integer)      },
 
+  /* INTVEC */
+  { "INTVEC.*",            push_instr_intvec_mul                               },
+  { "INTVEC.+",            push_instr_intvec_add                               },
+  { "INTVEC.-",            push_instr_intvec_sub                               },
+  { "INTVEC.=",            push_instr_poly_equal         , STACK(intvec)       },
+  { "INTVEC.CONJ",         push_instr_intvec_conj                              },
+  { "INTVEC.DEFINE",       push_instr_poly_define        , STACK(intvec)       },
+  { "INTVEC.DOT",          push_instr_intvec_dot                               },
+  { "INTVEC.DUP",          push_instr_poly_dup           , STACK(intvec)       },
+  { "INTVEC.EMPTYVECTOR",  push_instr_vec_empty          , STACK(intvec)       },
+  { "INTVEC.FLUSH",        push_instr_poly_flush         , STACK(intvec)       },
+  { "INTVEC.FROMREALVEC",  push_instr_intvec_fromrealvec                       },
+  { "INTVEC.LENGTH",       push_instr_vec_length         , STACK(intvec)       },
+  { "INTVEC.NTH",          push_instr_intvec_nth                               },
+  { "INTVEC.OFFSET",       push_instr_intvec_offset                            },
+  { "INTVEC.POP",          push_instr_poly_pop           , STACK(intvec)       },
+  { "INTVEC.PUSHALL",      push_instr_intvec_pushall                           },
+  { "INTVEC.ROT",          push_instr_poly_rot           , STACK(intvec)       },
+  { "INTVEC.SCALE",        push_instr_intvec_scale                             },
+  { "INTVEC.SHOVE",        push_instr_poly_shove         , STACK(intvec)       },
+  { "INTVEC.SLICE",        push_instr_vec_slice          , STACK(intvec)       },
+  { "INTVEC.STACKDEPTH",   push_instr_poly_stackdepth    , STACK(intvec)       },
+  { "INTVEC.SUM",          push_instr_intvec_sum                               },
+  { "INTVEC.SWAP",         push_instr_poly_swap          , STACK(intvec)       },
+  { "INTVEC.YANK",         push_instr_poly_yank          , STACK(intvec)       },
+  { "INTVEC.YANKDUP",      push_instr_poly_yankdup       , STACK(intvec)       },
+
   /* NAME */
   { "NAME.=",            push_instr_poly_equal         , STACK(name)         },
   { "NAME.DUP",          push_instr_poly_dup           , STACK(name)         },
@@ -1287,17 +1726,192 @@ struct push_dis_S push_dis[] = {
   { "REAL.YANK",          push_instr_poly_yank         , STACK(real)         },
   { "REAL.YANKDUP",       push_instr_poly_yankdup      , STACK(real)         },
 
+  /* REALVEC */
+  { "REALVEC.*",           push_instr_realvec_mul                              },
+  { "REALVEC.+",           push_instr_realvec_add                              },
+  { "REALVEC.-",           push_instr_realvec_sub                              },
+  { "REALVEC.=",           push_instr_poly_equal         , STACK(realvec)      },
+  { "REALVEC.CONJ",        push_instr_realvec_conj                             },
+  { "REALVEC.DEFINE",      push_instr_poly_define        , STACK(realvec)      },
+  { "REALVEC.DOT",         push_instr_realvec_dot                              },
+  { "REALVEC.DUP",         push_instr_poly_dup           , STACK(realvec)      },
+  { "REALVEC.EMPTYVECTOR", push_instr_vec_empty          , STACK(realvec)      },
+  { "REALVEC.FLUSH",       push_instr_poly_flush         , STACK(realvec)      },
+  { "REALVEC.FROMINTVEC",  push_instr_realvec_fromintvec                       },
+  { "REALVEC.LENGTH",      push_instr_vec_length         , STACK(realvec)      },
+  { "REALVEC.NTH",         push_instr_realvec_nth                              },
+  { "REALVEC.OFFSET",      push_instr_realvec_offset                           },
+  { "REALVEC.POP",         push_instr_poly_pop           , STACK(realvec)      },
+  { "REALVEC.PUSHALL",     push_instr_realvec_pushall                          },
+  { "REALVEC.ROT",         push_instr_poly_rot           , STACK(realvec)      },
+  { "REALVEC.SCALE",       push_instr_realvec_scale                            },
+  { "REALVEC.SHOVE",       push_instr_poly_shove         , STACK(realvec)      },
+  { "REALVEC.SLICE",       push_instr_vec_slice          , STACK(realvec)      },
+  { "REALVEC.STACKDEPTH",  push_instr_poly_stackdepth    , STACK(realvec)      },
+  { "REALVEC.SUM",         push_instr_realvec_sum                              },
+  { "REALVEC.SWAP",        push_instr_poly_swap          , STACK(realvec)      },
+  { "REALVEC.YANK",        push_instr_poly_yank          , STACK(realvec)      },
+  { "REALVEC.YANKDUP",     push_instr_poly_yankdup       , STACK(realvec)      },
+
+  /* STRING */
+  { "STRING.=",            push_instr_poly_equal         , STACK(string)       },
+  { "STRING.CHARAT",       push_instr_string_charat                            },
+  { "STRING.CONCAT",       push_instr_string_concat                            },
+  { "STRING.DEFINE",       push_instr_poly_define        , STACK(string)       },
+  { "STRING.DUP",          push_instr_poly_dup           , STACK(string)       },
+  { "STRING.EMPTYSTRING",  push_instr_string_emptystring                       },
+  { "STRING.FIND",         push_instr_string_find                              },
+  { "STRING.FLUSH",        push_instr_poly_flush         , STACK(string)       },
+  { "STRING.FROMINT",      push_instr_string_fromint                           },
+  { "STRING.FROMREAL",     push_instr_string_fromreal                          },
+  { "STRING.LENGTH",       push_instr_string_length                            },
+  { "STRING.POP",          push_instr_poly_pop           , STACK(string)       },
+  { "STRING.ROT",          push_instr_poly_rot           , STACK(string)       },
+  { "STRING.SHOVE",        push_instr_poly_shove         , STACK(string)       },
+  { "STRING.SPLIT",        push_instr_string_split                             },
+  { "STRING.STACKDEPTH",   push_instr_poly_stackdepth    , STACK(string)       },
+  { "STRING.SUBSTRING",    push_instr_string_substring                         },
+  { "STRING.SWAP",         push_instr_poly_swap          , STACK(string)       },
+  { "STRING.YANK",         push_instr_poly_yank          , STACK(string)       },
+  { "STRING.YANKDUP",      push_instr_poly_yankdup       , STACK(string)       },
+
   { NULL,                 NULL                                               }
 };
 
 
 
-void push_add_dis(push_t *push) {
+/* Instructions that read or change the EXEC stack (patterns)
+ * NOTE: these can't be part of a superinstruction
+ */
+static const char *push_dis_exec[] = {
+  "CODE.DO*",
+  "CODE.IF",
+  "CODE.QUOTE",
+  "EXEC.*",
+  "NAME.QUOTE",
+  NULL
+};
+
+
+static push_bool_t push_dis_uses_exec(const char *name) {
+  int i;
+
+  for (i = 0; push_dis_exec[i] != NULL; i++) {
+    if (g_pattern_match_simple(push_dis_exec[i], name)) {
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+
+/* Stack effects of default instructions (see push_instr_set_effect)
+ * NOTE: "*." matches POLY instructions of every type. Instructions without an
+ *       effect here are unknown, as are all instructions using the EXEC stack.
+ */
+static const struct {
+  const char *name;
+  const char *effect;
+  void *unchecked;
+} push_dis_effects[] = {
+  { "*.=",             "**>b",     push_instr_poly_equal_unchecked     },
+  { "*.DUP",           "*>**",     push_instr_poly_dup_unchecked       },
+  { "*.POP",           "*>",       push_instr_poly_pop_unchecked       },
+  { "*.ROT",           "***>***",  push_instr_poly_rot_unchecked       },
+  { "*.SWAP",          "**>**",    push_instr_poly_swap_unchecked      },
+  { "*.STACKDEPTH",    ">i",       NULL                                },
+  { "BOOL.AND",        "bb>b",     push_instr_bool_and_unchecked       },
+  { "BOOL.FROMINT",    "i>b",      push_instr_bool_fromint_unchecked   },
+  { "BOOL.FROMREAL",   "r>b",      push_instr_bool_fromreal_unchecked  },
+  { "BOOL.NOT",        "b>b",      push_instr_bool_not_unchecked       },
+  { "BOOL.OR",         "bb>b",     push_instr_bool_or_unchecked        },
+  { "BOOL.RAND",       ">b",       NULL                                },
+  { "INT.%",           "ii>i?",    push_instr_int_mod_unchecked        },
+  { "INT.*",           "ii>i",     push_instr_int_mul_unchecked        },
+  { "INT.+",           "ii>i",     push_instr_int_add_unchecked        },
+  { "INT.-",           "ii>i",     push_instr_int_sub_unchecked        },
+  { "INT./",           "ii>i?",    push_instr_int_div_unchecked        },
+  { "INT.LESS",        "ii>b",     push_instr_int_less_unchecked       },
+  { "INT.GREATER",     "ii>b",     push_instr_int_greater_unchecked    },
+  { "INT.FROMBOOL",    "b>i",      push_instr_int_frombool_unchecked   },
+  { "INT.FROMREAL",    "r>i",      push_instr_int_fromreal_unchecked   },
+  { "INT.MAX",         "ii>i",     push_instr_int_max_unchecked        },
+  { "INT.MIN",         "ii>i",     push_instr_int_min_unchecked        },
+  { "INT.RAND",        ">i",       NULL                                },
+  { "REAL.%",          "rr>r?",    push_instr_real_mod_unchecked       },
+  { "REAL.*",          "rr>r",     push_instr_real_mul_unchecked       },
+  { "REAL.+",          "rr>r",     push_instr_real_add_unchecked       },
+  { "REAL.-",          "rr>r",     push_instr_real_sub_unchecked       },
+  { "REAL./",          "rr>r?",    push_instr_real_div_unchecked       },
+  { "REAL.LESS",       "rr>b",     push_instr_real_less_unchecked      },
+  { "REAL.GREATER",    "rr>b",     push_instr_real_greater_unchecked   },
+  { "REAL.FROMBOOL",   "b>r",      push_instr_real_frombool_unchecked  },
+  { "REAL.FROMINT",    "i>r",      push_instr_real_fromint_unchecked   },
+  { "REAL.MAX",        "rr>r",     push_instr_real_max_unchecked       },
+  { "REAL.MIN",        "rr>r",     push_instr_real_min_unchecked       },
+  { "REAL.RAND",       ">r",       NULL                                },
+  { NULL,              NULL,       NULL                                }
+};
+
+
+static void push_dis_set_effect(push_instr_t *instr) {
+  const char *type = strchr(instr->name, '.');
+  int i;
+
+  for (i = 0; push_dis_effects[i].name != NULL; i++) {
+    if (strcmp(push_dis_effects[i].name, instr->name) == 0 ||
+        (push_dis_effects[i].name[0] == '*' && type != NULL && strcmp(push_dis_effects[i].name + 1, type) == 0)) {
+      push_instr_set_effect(instr, push_dis_effects[i].effect, (push_instr_func_t)push_dis_effects[i].unchecked);
+      return;
+    }
+  }
+}
+
+
+static void push_dis_reg(push_instrset_t *instrs) {
+  push_instr_t *instr;
   int i;
 
-  /* add default instructions */
+  /* add default instructions
+   * NOTE: the stack is resolved per interpreter, when the instruction is called
+   */
   for (i = 0; push_dis[i].name != NULL; i++) {
-    push_instr_reg(push, push_dis[i].name, (push_instr_func_t)push_dis[i].func, GETSTACK(push, push_dis[i].stack));
+    instr = push_instrset_reg(instrs, push_dis[i].name, (push_instr_func_t)push_dis[i].func, NULL, push_dis[i].poly ? push_dis[i].stack : -1);
+
+    if (!push_dis_uses_exec(instr->name)) {
+      instr->flags |= PUSH_INSTR_FUSABLE;
+      push_dis_set_effect(instr);
+    }
+  }
+}
+
+
+/* Returns new reference to the shared default instruction set */
+push_instrset_t *push_dis_instrset(void) {
+  static gsize dis_instrs = 0;
+  push_instrset_t *instrs;
+
+  if (g_once_init_enter(&dis_instrs)) {
+    instrs = push_instrset_new();
+    push_dis_reg(instrs);
+    g_once_init_leave(&dis_instrs, (gsize)instrs);
+  }
+
+  return push_instrset_ref((push_instrset_t*)dis_instrs);
+}
+
+
+void push_add_dis(push_t *push) {
+  g_return_if_null(push);
+
+  if (push_instrset_length(push->instructions) == 0) {
+    /* just use the shared set */
+    push_instrset_unref(push->instructions);
+    push->instructions = push_dis_instrset();
+  }
+  else {
+    push_dis_reg(push_instr_unshare(push));
   }
 }
 
@@ -48,14 +48,11 @@ static void gp_pc_right(push_t *push, push_gp_prog_t *prog) {
 
 static void gp_pc_input(push_t *push, push_gp_prog_t *prog) {
   pc_t *pc = (pc_t*)prog->userdata;
-  push_real_t th, th_v, x, x_v;
+  push_real_t inputs[4];
 
-  pc_get_output(pc, &th, &th_v, &x, &x_v);
-
-  push_stack_push_new(push, push->real, PUSH_TYPE_REAL, x_v);
-  push_stack_push_new(push, push->real, PUSH_TYPE_REAL, x);
-  push_stack_push_new(push, push->real, PUSH_TYPE_REAL, th_v);
-  push_stack_push_new(push, push->real, PUSH_TYPE_REAL, th);
+  /* push x_v, x, th_v, th (on top) */
+  pc_get_output(pc, &inputs[3], &inputs[2], &inputs[1], &inputs[0]);
+  push_plugin_push_reals(push, inputs, 4);
 }
 
 
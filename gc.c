@@ -31,22 +31,34 @@
 #define PUSH_GC_MSG_ADD_VAL            3
 #define PUSH_GC_MSG_REMOVE_VAL         4
 #define PUSH_GC_MSG_QUIT               5
+#define PUSH_GC_MSG_ADD_VALS           6
 struct push_gc_msg {
   int type;
   union {
     push_t *push;
     push_val_t *val;
+    push_val_t **vals;
     void *_data;
   };
+  /* number of values for PUSH_GC_MSG_ADD_VALS */
+  push_int_t num;
 };
 
 
 
 static void push_gc_mark_val(push_val_t *val, push_int_t *mark) {
+  push_code_walk_t walk;
+  push_val_t *val2;
+
   val->gc.mark = *mark;
 
   if (push_check_code(val)) {
-    g_queue_foreach(val->code, (GFunc)push_gc_mark_val, mark);
+    /* mark all values in code without recursion */
+    push_code_walk_init(&walk, val->code);
+    while ((val2 = push_code_walk_next(&walk)) != NULL) {
+      val2->gc.mark = *mark;
+    }
+    push_code_walk_clear(&walk);
   }
 }
 
@@ -64,11 +76,21 @@ static void push_gc_mark_hash_table(GHashTable *hash_table, push_int_t *mark) {
 
 
 static void push_gc_mark_stack(push_stack_t *stack, push_int_t *mark) {
-  g_queue_foreach(stack, (GFunc)push_gc_mark_val, mark);
+  GList *link;
+  push_val_t *val;
+
+  for (link = stack->values.head; link != NULL; link = link->next) {
+    val = (push_val_t*)link->data;
+
+    /* a cursor keeps its whole code value alive */
+    push_gc_mark_val(push_check_cursor(val) ? ((push_cursor_t*)val)->val : val, mark);
+  }
 }
 
 
 static void push_gc_mark_interpreter(push_t *push, push_int_t *mark) {
+  push_int_t i;
+
   g_static_mutex_lock(&push->mutex);
 
   /* mark stacks */
@@ -78,9 +100,14 @@ static void push_gc_mark_interpreter(push_t *push, push_int_t *mark) {
   push_gc_mark_stack(push->integer, mark);
   push_gc_mark_stack(push->name, mark);
   push_gc_mark_stack(push->real, mark);
+  push_gc_mark_stack(push->intvec, mark);
+  push_gc_mark_stack(push->realvec, mark);
+  push_gc_mark_stack(push->string, mark);
 
   /* mark bindings */
-  push_gc_mark_hash_table(push->bindings, mark);
+  for (i = 0; i < push_num_bound(push); i++) {
+    push_gc_mark_val(push_lookup(push, push_nth_bound(push, i)), mark);
+  }
 
   /* mark config */
   push_gc_mark_hash_table(push->config, mark);
@@ -117,6 +144,7 @@ static void *push_gc_main(GAsyncQueue *queue) {
   struct push_gc_msg *msg;
   GTimeVal end_time;
   push_bool_t alive = TRUE;
+  push_int_t i;
 
   /* initialize */
   g_async_queue_ref(queue);
@@ -142,6 +170,14 @@ static void *push_gc_main(GAsyncQueue *queue) {
             msg->val->gc.untrack = FALSE;
             values = g_list_prepend(values, msg->val);
             break;
+          case PUSH_GC_MSG_ADD_VALS:
+            for (i = 0; i < msg->num; i++) {
+              msg->vals[i]->gc.mark = mark;
+              msg->vals[i]->gc.untrack = FALSE;
+              values = g_list_prepend(values, msg->vals[i]);
+            }
+            g_free(msg->vals);
+            break;
           case PUSH_GC_MSG_REMOVE_VAL:
             msg->val->gc.untrack = TRUE;
             break;
@@ -151,9 +187,9 @@ static void *push_gc_main(GAsyncQueue *queue) {
           default:
             g_warning("%s: Unknown message type: %d", __func__, msg->type);
             break;
-
-          g_slice_free(struct push_gc_msg, msg);
         }
+
+        g_slice_free(struct push_gc_msg, msg);
       }
     } while (msg != NULL && alive);
 
@@ -161,7 +197,7 @@ static void *push_gc_main(GAsyncQueue *queue) {
     g_list_foreach(interpreters, (GFunc)push_gc_mark_interpreter, &mark);
 
     /* sweep values */
-    push_gc_sweep(values, mark);
+    values = push_gc_sweep(values, mark);
 
     g_thread_yield();
   }
@@ -181,6 +217,7 @@ static void push_gp_send(push_gc_t *gc, int type, void *data) {
   msg = g_slice_new(struct push_gc_msg);
   msg->type = type;
   msg->_data = data;
+  msg->num = 0;
   g_async_queue_push(gc->queue, msg);
 }
 
@@ -232,6 +269,24 @@ void push_gc_add_val(push_gc_t *gc, push_val_t *val, push_bool_t recursive) {
 }
 
 
+/* Add n values with a single message
+ * NOTE: vals is copied
+ */
+void push_gc_add_vals(push_gc_t *gc, push_val_t **vals, push_int_t n) {
+  struct push_gc_msg *msg;
+
+  if (n <= 0) {
+    return;
+  }
+
+  msg = g_slice_new(struct push_gc_msg);
+  msg->type = PUSH_GC_MSG_ADD_VALS;
+  msg->vals = g_memdup(vals, n * sizeof(push_val_t*));
+  msg->num = n;
+  g_async_queue_push(gc->queue, msg);
+}
+
+
 void push_gc_remove_val(push_gc_t *gc, push_val_t *val, push_bool_t recursive) {
   GList *link;
 
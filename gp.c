@@ -32,6 +32,7 @@ push_gp_t *push_gp_new(push_int_t population_size, push_int_t init_prog_size, pu
   push_gp_t *gp;
   push_int_t i;
   push_gp_prog_t *prog;
+  push_t *push;
 
   g_return_val_if_fail(population_size > 0, NULL);
   g_return_val_if_fail(init_prog_size > 0, NULL);
@@ -47,6 +48,13 @@ push_gp_t *push_gp_new(push_int_t population_size, push_int_t init_prog_size, pu
   gp->selection_func = selection_func == NULL ? push_gp_selection_roulette_wheel_linear: selection_func;
   gp->mutation_func = mutation_func == NULL ? push_gp_mutation_func: mutation_func;
   gp->crossover_func = crossover_func == NULL ? push_gp_crossover_one_point: crossover_func;
+  gp->simplify = FALSE;
+  gp->prepare = FALSE;
+
+  /* interpreters are created from a default template */
+  push = push_new();
+  gp->template = push_template_new(push);
+  push_destroy(push);
 
   /* initialize random population */
   gp->pop = g_ptr_array_sized_new(population_size);
@@ -76,6 +84,8 @@ void push_gp_destroy(push_gp_t *gp) {
   }
   g_ptr_array_free(gp->pop, TRUE);
 
+  push_template_unref(gp->template);
+
   g_slice_free(push_gp_t, gp);
 }
 
@@ -90,16 +100,18 @@ push_gp_prog_t *push_gp_get_nth(push_gp_t *gp, push_int_t i) {
 }
 
 
-void push_gp_init_program(push_gp_t *gp, push_gp_prog_t *prog, push_int_t size, push_t *push_template) {
+void push_gp_init_program(push_gp_t *gp, push_gp_prog_t *prog, push_int_t size, push_template_t *template) {
   push_t *push;
 
-  push = push_template == NULL ? push_new() : push_copy(push_template);
+  push = push_new_from_template(template == NULL ? gp->template : template);
   push->userdata = prog;
   push_rand_set_seed(push, g_rand_int(gp->rand));
 
   prog->push = push;
   prog->code = push_rand_val(push, PUSH_TYPE_CODE, &size, TRUE);
+  prog->eval = FALSE;
   prog->fitness = 0.0;
+  prog->simplified = 0;
   prog->userdata = NULL;
 
   if (gp->init_func != NULL) {
@@ -108,7 +120,10 @@ void push_gp_init_program(push_gp_t *gp, push_gp_prog_t *prog, push_int_t size,
 }
 
 
-void push_gp_run_program(push_gp_t *gp, push_gp_prog_t *prog) {
+/* sets up interpreter of program for a run */
+static void push_gp_prepare_program(push_gp_t *gp, push_gp_prog_t *prog) {
+  push_val_t *val;
+
   /* flush all stacks and remove all bindings */
   push_flush(prog->push);
 
@@ -119,34 +134,66 @@ void push_gp_run_program(push_gp_t *gp, push_gp_prog_t *prog) {
     gp->prepare_func(gp, prog);
   }
 
+  /* NOTE: the CODE stack still has the original program */
+  if ((gp->simplify || gp->prepare) && push_stack_peek(prog->push->exec) == prog->code) {
+    val = push_stack_pop(prog->push->exec);
+
+    if (gp->simplify) {
+      val = push_simplify(prog->push, val, &prog->simplified);
+    }
+    if (gp->prepare) {
+      val = push_prepare(prog->push, val);
+    }
+
+    push_stack_push(prog->push->exec, val);
+  }
+}
+
+
+void push_gp_run_program(push_gp_t *gp, push_gp_prog_t *prog) {
+  push_gp_prepare_program(gp, prog);
   push_vm_run(gp->vm, prog->push);
 }
 
 
 void push_gp_eval(push_gp_t *gp) {
-  push_int_t i;
+  push_int_t i, n = 0;
   push_gp_prog_t *prog;
+  push_t **pushes;
+  push_vm_future_t **futures, *future;
+  GAsyncQueue *completions;
 
-  /* run all programs */
+  /* run all programs that weren't evaluated yet */
+  pushes = g_new(push_t*, gp->pop->len);
   for (i = 0; i < gp->pop->len; i++) {
     prog = push_gp_get_nth(gp, i);
 
     if (!prog->eval) {
-      push_gp_run_program(gp, prog);
+      push_gp_prepare_program(gp, prog);
+      pushes[n++] = prog->push;
     }
   }
 
-  /* wait until all programs finished */
-  push_vm_wait(gp->vm);
+  completions = g_async_queue_new();
+  futures = push_vm_run_many(gp->vm, pushes, n, completions);
 
-  /* set eval flag and call fitness function */
-  for (i = 0; i < gp->pop->len; i++) {
-    if (!prog->eval) {
-      prog->eval = TRUE;
-      /* TODO: 3rd argument: pass number of steps */
-      prog->fitness = gp->fitness_func(gp, prog, 0);
-    }
+  /* set eval flag and call fitness function, as the programs finish */
+  for (i = 0; i < n; i++) {
+    future = (push_vm_future_t*)g_async_queue_pop(completions);
+    prog = (push_gp_prog_t*)future->push->userdata;
+
+    prog->eval = TRUE;
+    prog->fitness = gp->fitness_func(gp, prog, future->steps);
+
+    push_vm_future_unref(future);
+  }
+
+  for (i = 0; i < n; i++) {
+    push_vm_future_unref(futures[i]);
   }
+  g_free(futures);
+  g_free(pushes);
+  g_async_queue_unref(completions);
 }
 
 
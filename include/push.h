@@ -32,16 +32,24 @@
 
 
 /* Include all header files */
+#include "push/channel.h"
 #include "push/code.h"
 #include "push/gc.h"
 #include "push/gp.h"
 #include "push/instr.h"
+#include "push/name.h"
+#include "push/plugin.h"
+#include "push/pool.h"
+#include "push/profile.h"
 #include "push/rand.h"
 #include "push/serialize.h"
+#include "push/simplify.h"
 #include "push/stack.h"
+#include "push/str.h"
 #include "push/types.h"
 #include "push/unserialize.h"
 #include "push/val.h"
+#include "push/vec.h"
 #include "push/vm.h"
 
 
@@ -52,6 +60,7 @@
 
 
 
+push_instrset_t *push_dis_instrset(void);
 void push_add_dis(push_t *push);
 int push_version(void);
 
@@ -0,0 +1,91 @@
+/* channel.h - Channels between interpreters
+ *
+ * Copyright (c) 2012 Janosch Gräf <janosch.graef@gmx.net>
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef _PUSH_CHANNEL_H_
+#define _PUSH_CHANNEL_H_
+
+
+#include <glib.h>
+
+
+typedef struct push_channel_S push_channel_t;
+typedef struct push_channel_node_S push_channel_node_t;
+typedef struct push_channels_S push_channels_t;
+
+
+#include "push/types.h"
+#include "push/interpreter.h"
+#include "push/val.h"
+#include "push/vm.h"
+
+
+/* Node of the message queue */
+struct push_channel_node_S {
+  push_channel_node_t *next;
+  push_val_t *val;
+};
+
+
+/* Channel: queue of values sent from one interpreter to others
+ * NOTE: Values are copied when they're sent, so they don't belong to any
+ *       interpreter while they're in the channel. The queue doesn't need
+ *       a lock: senders only swap the head, and the one receiver taking
+ *       values at a time only moves the tail (the queue always keeps
+ *       one node, whose value has been taken already).
+ */
+struct push_channel_S {
+  /* newest node (senders) */
+  push_channel_node_t *head;
+
+  /* node before the oldest value (receiver) */
+  push_channel_node_t *tail;
+
+  /* number of values in the channel */
+  gint length;
+
+  /* whether some interpreter is taking a value */
+  gint receiving;
+
+  /* processes waiting for a value */
+  push_vm_waitq_t *waitq;
+};
+
+
+/* Set of channels that CHANNEL.SEND and CHANNEL.RECV refer to by number */
+struct push_channels_S {
+  push_int_t num;
+  push_channel_t **channels;
+};
+
+
+push_channel_t *push_channel_new(void);
+void push_channel_destroy(push_channel_t *channel);
+void push_channel_send(push_channel_t *channel, push_val_t *val);
+push_val_t *push_channel_recv(push_channel_t *channel, push_t *push);
+push_int_t push_channel_length(push_channel_t *channel);
+push_channels_t *push_channels_new(push_int_t num);
+void push_channels_destroy(push_channels_t *channels);
+push_channel_t *push_channels_get(push_channels_t *channels, push_int_t id);
+void push_channels_reg(push_t *push, push_channels_t *channels);
+
+
+#endif /* _PUSH_CHANNEL_H_ */
@@ -28,6 +28,8 @@
 
 
 typedef GQueue push_code_t;
+typedef struct push_code_subtrees_S push_code_subtrees_t;
+typedef struct push_code_walk_S push_code_walk_t;
 
 
 #include "push/types.h"
@@ -36,6 +38,32 @@ typedef GQueue push_code_t;
 #include "push/val.h"
 
 
+/* Iterative pre-order walk over code (see push_code_walk_next) */
+struct push_code_walk_S {
+  /* code to walk, until first value is returned */
+  push_code_t *code;
+
+  /* link of current value */
+  GList *link;
+
+  /* links of code values containing current value: GList* */
+  GPtrArray *path;
+
+  /* don't descend into current value */
+  push_bool_t skip;
+};
+
+
+/* Index of sub-values of code by structural hash */
+struct push_code_subtrees_S {
+  /* hash -> 1 + index of first entry with that hash */
+  GHashTable *heads;
+
+  /* entries: struct push_code_subtree (see code.c) */
+  GArray *entries;
+};
+
+
 push_code_t *push_code_new(void);
 void push_code_destroy(push_code_t *code);
 void push_code_append(push_code_t *code, push_val_t *val);
@@ -47,11 +75,20 @@ push_val_t *push_code_peek(push_code_t *code);
 push_val_t *push_code_peek_nth(push_code_t *code, int n);
 int push_code_length(push_code_t *code);
 void push_code_flush(push_code_t *code);
+void push_code_walk_init(push_code_walk_t *walk, push_code_t *code);
+void push_code_walk_clear(push_code_walk_t *walk);
+void push_code_walk_skip(push_code_walk_t *walk);
+push_val_t *push_code_walk_next(push_code_walk_t *walk);
+int push_code_walk_depth(push_code_walk_t *walk);
 push_code_t *push_code_dup_ext(push_code_t *code, GList *first_link, GList *last_link, GList *replace_link, push_val_t *replace_with);
 push_code_t *push_code_dup(push_code_t *code);
 push_bool_t push_code_equal(push_code_t *code1, push_code_t *code2);
+guint push_code_hash(push_code_t *code);
 push_code_t *push_code_concat(push_code_t *code1, push_code_t *code2);
 push_code_t *push_code_container(push_code_t *haystack, push_val_t *needle);
+push_code_subtrees_t *push_code_subtrees_new(push_code_t *code);
+void push_code_subtrees_destroy(push_code_subtrees_t *index);
+push_code_t *push_code_subtrees_container(push_code_subtrees_t *index, push_val_t *needle);
 int push_code_discrepancy(push_code_t *code1, push_code_t *code2);
 push_val_t *push_code_extract(push_code_t *code, push_int_t point);
 int push_code_index(push_code_t *haystack, push_val_t *needle);
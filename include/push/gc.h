@@ -63,6 +63,7 @@ void push_gc_destroy(push_gc_t *gc);
 void push_gc_add_interpreter(push_gc_t *gc, push_t *push);
 void push_gc_remove_interpreter(push_gc_t *gc, push_t *push);
 void push_gc_add_val(push_gc_t *gc, push_val_t *val, push_bool_t recursive);
+void push_gc_add_vals(push_gc_t *gc, push_val_t **vals, push_int_t n);
 void push_gc_remove_val(push_gc_t *gc, push_val_t *val, push_bool_t recursive);
 push_gc_t *push_gc_global(void);
 
@@ -56,6 +56,9 @@ struct push_gp_prog_S {
   /* Fitness after evaluation */
   push_real_t fitness;
 
+  /* Points removed by the simplifier in the last run */
+  push_int_t simplified;
+
   /* User data */
   void *userdata;
 };
@@ -93,6 +96,15 @@ struct push_gp_S {
   /* Crossover function */
   push_gp_crossover_func_t crossover_func;
 
+  /* Template for the interpreters of new programs */
+  push_template_t *template;
+
+  /* Run programs simplified for the stacks set up by prepare_func (see push_simplify) */
+  push_bool_t simplify;
+
+  /* Run programs with the superinstructions of the template's instruction set (see push_prepare) */
+  push_bool_t prepare;
+
   /* User data */
   void *userdata;
 };
@@ -104,7 +116,7 @@ push_gp_t *push_gp_new(push_int_t population_size, push_int_t init_prog_size, pu
 void push_gp_destroy(push_gp_t *gp);
 push_int_t push_gp_get_num(push_gp_t *gp);
 push_gp_prog_t *push_gp_get_nth(push_gp_t *gp, push_int_t i);
-void push_gp_init_program(push_gp_t *gp, push_gp_prog_t *prog, push_int_t size, push_t *push_template);
+void push_gp_init_program(push_gp_t *gp, push_gp_prog_t *prog, push_int_t size, push_template_t *template);
 void push_gp_run_program(push_gp_t *gp, push_gp_prog_t *prog);
 void push_gp_eval(push_gp_t *gp);
 void push_gp_generation(push_gp_t *gp);
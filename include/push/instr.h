@@ -25,6 +25,8 @@
 
 
 typedef struct push_instr_S push_instr_t;
+typedef struct push_instrset_S push_instrset_t;
+typedef struct push_instr_effect_S push_instr_effect_t;
 
 
 #include "push/types.h"
@@ -35,14 +37,114 @@ typedef struct push_instr_S push_instr_t;
 typedef void (*push_instr_func_t)(push_t *push, void *userdata);
 
 
+/* Instruction flags */
+#define PUSH_INSTR_FUSABLE 1 /* doesn't touch the EXEC stack, so it can be part of a superinstruction */
+
+/* Stacks in stack effects */
+#define PUSH_STACK_BOOL    0 /* b */
+#define PUSH_STACK_CODE    1 /* c */
+#define PUSH_STACK_EXEC    2 /* e */
+#define PUSH_STACK_INT     3 /* i */
+#define PUSH_STACK_NAME    4 /* n */
+#define PUSH_STACK_REAL    5 /* r */
+#define PUSH_STACK_INTVEC  6 /* v */
+#define PUSH_STACK_REALVEC 7 /* w */
+#define PUSH_STACK_STRING  8 /* s */
+#define PUSH_STACK_NUM     9
+
+/* Results of push_instr_effect_step */
+#define PUSH_INSTR_NOOP    0
+#define PUSH_INSTR_RUNS    1
+#define PUSH_INSTR_MAYBE  -1
+
+
+/* Stack effect: if every stack has at least pops[i] values, the instruction
+ * takes them and pushes between pushes[i] and pushes_max[i] values. Otherwise
+ * it does nothing.
+ */
+struct push_instr_effect_S {
+  push_int_t pops[PUSH_STACK_NUM];
+  push_int_t pushes[PUSH_STACK_NUM];
+  push_int_t pushes_max[PUSH_STACK_NUM];
+};
+
+
 /* Instruction type */
 struct push_instr_S {
   push_name_t name;
+  push_int_t opcode;
   push_instr_func_t func;
   void *userdata;
+
+  /* offset of a stack in push_t that is passed instead of userdata, or -1 */
+  gssize stack;
+
+  /* PUSH_INSTR_* flags */
+  push_int_t flags;
+
+  /* instructions run by a superinstruction (NULL-terminated), or NULL */
+  push_instr_t **parts;
+
+  /* stack effect, or NULL if unknown */
+  push_instr_effect_t *effect;
+
+  /* variant of func, that doesn't check the stacks (see effect), or NULL */
+  push_instr_func_t unchecked;
 };
 
 
+/* Instruction set: name -> instruction, opcode -> instruction
+ * NOTE: Reference counted and shared between interpreters. A set must not be
+ *       changed while it's shared, push_instr_reg copies it first.
+ */
+struct push_instrset_S {
+  volatile gint ref_count;
+
+  /* set this one was copied from, owns the inherited instructions */
+  push_instrset_t *parent;
+
+  /* name -> push_instr_t* */
+  GHashTable *by_name;
+
+  /* opcode -> push_instr_t* */
+  GPtrArray *by_opcode;
+
+  /* instructions allocated by this set */
+  GPtrArray *owned;
+
+  /* opcode -> sampling weight (gdouble) */
+  GArray *weights;
+
+  /* opcode -> whether the instruction is part of the set (gboolean) */
+  GArray *included;
+
+  /* alias method tables for push_instrset_sample, if sampler_valid */
+  GArray *alias_prob;
+  GArray *alias;
+  gint sampler_valid;
+};
+
+
+push_instrset_t *push_instrset_new(void);
+push_instrset_t *push_instrset_copy(push_instrset_t *instrs);
+push_instrset_t *push_instrset_ref(push_instrset_t *instrs);
+void push_instrset_unref(push_instrset_t *instrs);
+push_instr_t *push_instrset_reg(push_instrset_t *instrs, const char *name, push_instr_func_t func, void *userdata, gssize stack);
+push_instr_t *push_instrset_lookup(push_instrset_t *instrs, const char *name);
+push_instr_t *push_instrset_get(push_instrset_t *instrs, push_int_t opcode);
+push_int_t push_instrset_length(push_instrset_t *instrs);
+push_instr_t *push_instrset_reg_super(push_instrset_t *instrs, push_instr_t **parts, push_int_t n);
+void push_instrset_select(push_instrset_t *instrs, const char **patterns);
+push_instrset_t *push_instrset_subset(push_instrset_t *instrs, const char **patterns);
+push_int_t push_instrset_set_weight(push_instrset_t *instrs, const char *pattern, gdouble weight);
+push_instr_t *push_instrset_sample(push_instrset_t *instrs, GRand *rand);
+
+push_instrset_t *push_instr_unshare(push_t *push);
+push_bool_t push_instr_set_effect(push_instr_t *instr, const char *effect, push_instr_func_t unchecked);
+push_bool_t push_instr_effect_check(push_t *push, push_instr_effect_t *effect);
+push_int_t push_instr_effect_step(push_instr_t *instr, push_int_t *lo, push_int_t *hi);
+push_stack_t *push_instr_get_stack(push_t *push, push_int_t i);
+void push_instr_load_config(push_t *push);
 void push_instr_reg(push_t *push, const char *name, push_instr_func_t func, void *userdata);
 void push_instr_destroy(push_instr_t *instr);
 push_instr_t *push_instr_lookup(push_t *push, const char *name);
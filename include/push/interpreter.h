@@ -28,17 +28,19 @@
 
 
 typedef struct push_S push_t;
+typedef struct push_binding_S push_binding_t;
+typedef struct push_template_S push_template_t;
+typedef struct push_pool_S push_pool_t;
 
 
 #include "push/types.h"
+#include "push/name.h"
 #include "push/stack.h"
 #include "push/val.h"
+#include "push/profile.h"
 
 
 
-#define PUSH_NAME_STORAGE_BLOCK_SIZE 1024
-
-
 /* Interrupt handler type */
 typedef void (*push_interrupt_handler_t)(push_t *push, push_int_t interrupt_flag, void *userdata);
 
@@ -46,6 +48,42 @@ typedef void (*push_interrupt_handler_t)(push_t *push, push_int_t interrupt_flag
 typedef push_bool_t (*push_step_hook_t)(push_t *push, void *userdata);
 
 
+/* Binding of a name: slot of the bindings hash table
+ * NOTE: only valid if its generation is the interpreter's generation, so
+ *       that all bindings can be removed at once
+ */
+struct push_binding_S {
+  /* name of the slot, or NULL if the slot was never used
+   * NOTE: the slot references it, also after the binding became invalid,
+   *       until the slot is reused
+   */
+  push_name_t name;
+
+  /* bound value, or NULL */
+  push_val_t *val;
+
+  /* position of the name in bound (only if valid) */
+  push_int_t pos;
+
+  /* generation of the bindings this binding belongs to */
+  push_int_t generation;
+};
+
+
+/* Interpreter template: configuration, bindings and instructions that are
+ * shared copy-on-write by all interpreters created from it
+ */
+struct push_template_S {
+  /* reference counter */
+  gint ref_count;
+
+  /* interpreter holding the shared state
+   * NOTE: it's never run or changed, it only keeps the values alive
+   */
+  push_t *push;
+};
+
+
 /* Interpreter */
 struct push_S {
   /* stacks: push_val_t */
@@ -55,6 +93,9 @@ struct push_S {
   push_stack_t *integer;
   push_stack_t *name;
   push_stack_t *real;
+  push_stack_t *intvec;
+  push_stack_t *realvec;
+  push_stack_t *string;
 
   /* Interrupt flag & handler */
   push_int_t interrupt_flag;
@@ -69,23 +110,42 @@ struct push_S {
   /* Interpreter configuration */
   GHashTable *config;
 
-  /* bindings: push_name_t -> push_val_t* */
-  GHashTable *bindings;
+  /* bindings: open-addressed hash table of push_binding_t, by name id
+   * NOTE: bindings_size is a power of 2, and bindings_used is the number of
+   *       slots with a name
+   */
+  push_binding_t *bindings;
+  push_int_t bindings_size;
+  push_int_t bindings_used;
+
+  /* all bound names (in no particular order) */
+  GPtrArray *bound;
+
+  /* current generation of the bindings */
+  push_int_t generation;
 
-  /* instructions */
-  GHashTable *instructions;
+  /* instructions (shared) */
+  push_instrset_t *instructions;
+
+  /* instruction profile, if not NULL */
+  push_profile_t *profile;
 
   /* random number generator */
   GRand *rand;
 
-  /* storage for interned strings */
-  GStringChunk *names;
-
   /* Lock against concurrent execution */
   GStaticMutex mutex;
 
   /* garbage collector */
   push_gc_t *gc;
+
+  /* template this interpreter was created from, or NULL
+   * NOTE: configuration and bindings are shared with it until changed
+   */
+  push_template_t *template;
+
+  /* pool this interpreter was taken from, or NULL */
+  push_pool_t *pool;
 };
 
 
@@ -93,16 +153,24 @@ push_t *push_new_full(push_bool_t default_instructions, push_bool_t default_conf
 push_t *push_new(void);
 void push_destroy(push_t *push);
 push_t *push_copy(push_t *push);
+push_template_t *push_template_new(push_t *push);
+push_template_t *push_template_ref(push_template_t *template);
+void push_template_unref(push_template_t *template);
+push_t *push_new_from_template(push_template_t *template);
 void push_flush(push_t *push);
+void push_reset(push_t *push);
 push_name_t push_intern_name(push_t *push, const char *name);
 void push_config_set(push_t *push, const char *key, push_val_t *val);
 push_val_t *push_config_get(push_t *push, const char *key);
 void push_define(push_t *push, push_name_t name, push_val_t *val);
 void push_undef(push_t *push, push_name_t name);
 push_val_t *push_lookup(push_t *push, push_name_t name);
+push_int_t push_num_bound(push_t *push);
+push_name_t push_nth_bound(push_t *push, push_int_t n);
 void push_do_val(push_t *push, push_val_t *val);
 push_bool_t push_step(push_t *push);
 push_int_t push_run(push_t *push, push_int_t max_steps);
+push_int_t push_resume(push_t *push, push_int_t max_steps);
 push_bool_t push_done(push_t *push);
 char *push_dump_state(push_t *push);
 void push_free(void *ptr);
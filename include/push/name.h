@@ -0,0 +1,50 @@
+/* name.h - Interned names
+ *
+ * Copyright (c) 2012 Janosch Gräf <janosch.graef@gmx.net>
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef _PUSH_NAME_H_
+#define _PUSH_NAME_H_
+
+
+#include <glib.h>
+
+
+#include "push/types.h"
+
+
+/* Id of a name: dense for interned names, negative for generated names
+ * NOTE: names are stored right after their id
+ */
+#define push_name_id(name) (((push_int_t*)(name))[-1])
+
+/* whether a name is interned (see push_name_intern) */
+#define push_name_is_interned(name) (push_name_id(name) >= 0)
+
+
+push_name_t push_name_intern(const char *name);
+push_name_t push_name_get(push_int_t id);
+push_int_t push_name_count(void);
+push_name_t push_name_new(const char *name);
+push_name_t push_name_ref(push_name_t name);
+void push_name_unref(push_name_t name);
+
+
+#endif /* _PUSH_NAME_H_ */
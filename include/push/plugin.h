@@ -0,0 +1,85 @@
+/* plugin.h - Native instruction plugins
+ *
+ * Copyright (c) 2012 Janosch Gräf <janosch.graef@gmx.net>
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef _PUSH_PLUGIN_H_
+#define _PUSH_PLUGIN_H_
+
+
+#include <glib.h>
+#include <gmodule.h>
+
+
+typedef struct push_plugin_S push_plugin_t;
+
+
+#include "push/types.h"
+#include "push/instr.h"
+#include "push/interpreter.h"
+
+
+/* Version of the plugin ABI
+ * NOTE: increased whenever push_t, push_val_t or push_plugin_t change.
+ *       Plugins built for another version aren't loaded.
+ */
+#define PUSH_PLUGIN_ABI_VERSION 1
+
+/* Name of the push_plugin_t every plugin exports */
+#define PUSH_PLUGIN_SYMBOL "push_plugin"
+
+/* Declare a plugin, e.g. PUSH_PLUGIN("polecart", pc_plugin_init) */
+#define PUSH_PLUGIN(name, init) \
+  G_MODULE_EXPORT const push_plugin_t push_plugin = { PUSH_PLUGIN_ABI_VERSION, name, init }
+
+
+/* Registers the instructions of a plugin with push_instrset_reg and returns
+ * if this succeeded. userdata is the one passed to push_plugin_load.
+ */
+typedef push_bool_t (*push_plugin_init_func_t)(push_instrset_t *instrs, void *userdata);
+
+
+/* Plugin, loaded from a shared object
+ * NOTE: Instructions of plugins are usual instructions (push_instr_func_t).
+ *       They get direct access to the stacks of the interpreter, and can use
+ *       push_plugin_push_* and push_plugin_pop_* to move many values at once.
+ */
+struct push_plugin_S {
+  /* PUSH_PLUGIN_ABI_VERSION the plugin was built for */
+  push_int_t abi_version;
+
+  /* Name of the plugin */
+  const char *name;
+
+  /* Init function */
+  push_plugin_init_func_t init;
+};
+
+
+push_bool_t push_plugin_load(push_t *push, const char *filename, void *userdata);
+void push_plugin_push_bools(push_t *push, const push_bool_t *bools, push_int_t n);
+void push_plugin_push_ints(push_t *push, const push_int_t *ints, push_int_t n);
+void push_plugin_push_reals(push_t *push, const push_real_t *reals, push_int_t n);
+push_bool_t push_plugin_pop_bools(push_t *push, push_bool_t *bools, push_int_t n);
+push_bool_t push_plugin_pop_ints(push_t *push, push_int_t *ints, push_int_t n);
+push_bool_t push_plugin_pop_reals(push_t *push, push_real_t *reals, push_int_t n);
+
+
+#endif /* _PUSH_PLUGIN_H_ */
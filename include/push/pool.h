@@ -0,0 +1,60 @@
+/* pool.h - Pools of interpreters
+ *
+ * Copyright (c) 2012 Janosch Gräf <janosch.graef@gmx.net>
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef _PUSH_POOL_H_
+#define _PUSH_POOL_H_
+
+
+#include <glib.h>
+
+
+#include "push/types.h"
+#include "push/interpreter.h"
+
+
+/* Pool of interpreters created from a template
+ * NOTE: Interpreters are reset when they're put back (see push_reset), so
+ *       taking one from the pool costs next to nothing.
+ */
+struct push_pool_S {
+  /* template of the interpreters */
+  push_template_t *template;
+
+  /* interpreters that are ready to be taken: push_t */
+  GPtrArray *free;
+
+  /* max number of interpreters kept, or 0 for no limit */
+  push_int_t max_free;
+
+  /* mutex */
+  GMutex *mutex;
+};
+
+
+push_pool_t *push_pool_new(push_template_t *template, push_int_t max_free);
+void push_pool_destroy(push_pool_t *pool);
+push_t *push_pool_get(push_pool_t *pool);
+void push_pool_put(push_pool_t *pool, push_t *push);
+void push_pool_fill(push_pool_t *pool, push_int_t num);
+
+
+#endif /* _PUSH_POOL_H_ */
@@ -0,0 +1,70 @@
+/* profile.h - Instruction profiles & superinstructions
+ *
+ * Copyright (c) 2012 Janosch Gräf <janosch.graef@gmx.net>
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef _PUSH_PROFILE_H_
+#define _PUSH_PROFILE_H_
+
+
+#include <glib.h>
+
+
+typedef struct push_profile_S push_profile_t;
+typedef struct push_profile_seq_S push_profile_seq_t;
+
+
+#include "push/types.h"
+#include "push/instr.h"
+#include "push/interpreter.h"
+#include "push/val.h"
+
+
+/* maximum length of profiled instruction sequences and superinstructions */
+#define PUSH_PROFILE_MAX_SEQ 3
+
+
+/* Sequence of instructions executed right after each other */
+struct push_profile_seq_S {
+  push_int_t length;
+  push_instr_t *instrs[PUSH_PROFILE_MAX_SEQ];
+  guint64 count;
+};
+
+
+/* Execution counts of single instructions and sequences of fusable ones */
+struct push_profile_S {
+  /* push_profile_seq_t -> itself */
+  GHashTable *seqs;
+
+  /* last instructions executed (most recent first), NULL after other values */
+  push_instr_t *last[PUSH_PROFILE_MAX_SEQ - 1];
+};
+
+
+push_profile_t *push_profile_new(void);
+void push_profile_destroy(push_profile_t *profile);
+void push_profile_step(push_profile_t *profile, push_val_t *val);
+guint64 push_profile_count(push_profile_t *profile, push_instr_t **instrs, push_int_t n);
+push_instrset_t *push_profile_fuse(push_profile_t *profile, push_instrset_t *instrs, push_int_t max_super, guint64 min_count);
+push_val_t *push_prepare(push_t *push, push_val_t *val);
+
+
+#endif /* _PUSH_PROFILE_H_ */
@@ -27,7 +27,8 @@
 #include <glib.h>
 
 
-typedef GQueue push_stack_t;
+typedef struct push_stack_S push_stack_t;
+typedef struct push_cursor_S push_cursor_t;
 
 
 #include "push/types.h"
@@ -37,19 +38,50 @@ typedef GQueue push_stack_t;
 #define push_stack_push_new(push, stack, type, ...)  push_stack_push(stack, push_val_new(push, type, __VA_ARGS__))
 #define push_stack_pop_code(push)                    push_val_make_code(push, push_stack_pop((push)->code))
 #define push_stack_peek_code(push)                   push_val_make_code(push, push_stack_peek((push)->code))
-#define push_stack_is_empty(stack)                   (stack->head == NULL)
+#define push_stack_is_empty(stack)                   ((stack)->length == 0)
+
+
+/* Cursor: stands for the elements of a code value that weren't taken from the
+ * stack yet
+ * NOTE: Only the stack functions see cursors, they never return one
+ */
+struct push_cursor_S {
+  /* PUSH_TYPE_CURSOR, at the same position as push_val_t.type */
+  int type;
+
+  /* number of elements left */
+  int remaining;
+
+  /* code value and link of its next element */
+  push_val_t *val;
+  GList *link;
+};
+
+
+/* Stack */
+struct push_stack_S {
+  /* top-most entry is head: push_val_t* or push_cursor_t* */
+  GQueue values;
+
+  /* number of values on stack (counting all values left in cursors) */
+  int length;
+};
 
 
 push_stack_t *push_stack_new(void);
 void push_stack_destroy(push_stack_t *stack);
 void push_stack_push(push_stack_t *stack, push_val_t *val);
+void push_stack_push_code(push_stack_t *stack, push_val_t *val);
 void push_stack_push_nth(push_stack_t *stack, push_int_t n, push_val_t *val);
 push_val_t *push_stack_pop(push_stack_t *stack);
 push_val_t *push_stack_pop_nth(push_stack_t *stack, push_int_t n);
 push_val_t *push_stack_peek(push_stack_t *stack);
 push_val_t *push_stack_peek_nth(push_stack_t *stack, push_int_t n);
 int push_stack_length(push_stack_t *stack);
+void push_stack_push_array(push_t *push, push_stack_t *stack, int type, const void *data, push_int_t n);
+push_int_t push_stack_read_array(push_stack_t *stack, int type, void *data, push_int_t n);
 void push_stack_flush(push_stack_t *stack);
+void push_stack_foreach(push_stack_t *stack, GFunc func, void *userdata);
 push_stack_t *push_stack_copy(push_stack_t *stack, push_t *to_push);
 
 
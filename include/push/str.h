@@ -0,0 +1,64 @@
+/* str.h - Immutable strings
+ *
+ * Copyright (c) 2012 Janosch Gräf <janosch.graef@gmx.net>
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef _PUSH_STR_H_
+#define _PUSH_STR_H_
+
+
+#include <glib.h>
+
+
+typedef struct push_str_S push_str_t;
+
+
+#include "push/types.h"
+
+
+/* strings up to this length are copied instead of referring to a larger one */
+#define PUSH_STR_SMALL 16
+
+
+/* String: reference counted byte string, that is never changed
+ * NOTE: substrings share the data of their base string, so data isn't
+ *       NUL-terminated in general
+ */
+struct push_str_S {
+  volatile gint ref_count;
+  push_int_t length;
+  const char *data;
+
+  /* string owning data, or NULL if data is stored after this struct */
+  push_str_t *base;
+};
+
+
+push_str_t *push_str_new(const char *data, push_int_t length);
+push_str_t *push_str_ref(push_str_t *str);
+void push_str_unref(push_str_t *str);
+push_str_t *push_str_sub(push_str_t *str, push_int_t start, push_int_t end);
+push_str_t *push_str_concat(push_str_t *str1, push_str_t *str2);
+push_int_t push_str_find(push_str_t *haystack, push_str_t *needle);
+push_bool_t push_str_equal(push_str_t *str1, push_str_t *str2);
+guint push_str_hash(push_str_t *str);
+
+
+#endif /* _PUSH_STR_H_ */
@@ -32,7 +32,7 @@
 #endif
 typedef int push_bool_t;
 typedef int push_int_t;
-typedef char *push_name_t; /* NOTE: interned string */
+typedef char *push_name_t; /* NOTE: interned or generated string (see name.h) */
 typedef double push_real_t;
 
 
@@ -32,6 +32,8 @@ typedef struct push_val_S push_val_t;
 #include "push/instr.h"
 #include "push/code.h"
 #include "push/gc.h"
+#include "push/str.h"
+#include "push/vec.h"
 
 
 
@@ -42,6 +44,11 @@ typedef struct push_val_S push_val_t;
 #define push_check_instr(v)           ((v)->type == PUSH_TYPE_INSTR)
 #define push_check_name(v)            ((v)->type == PUSH_TYPE_NAME)
 #define push_check_real(v)            ((v)->type == PUSH_TYPE_REAL)
+#define push_check_intvec(v)          ((v)->type == PUSH_TYPE_INTVEC)
+#define push_check_realvec(v)         ((v)->type == PUSH_TYPE_REALVEC)
+#define push_check_vec(v)             (push_check_intvec(v) || push_check_realvec(v))
+#define push_check_string(v)          ((v)->type == PUSH_TYPE_STRING)
+#define push_check_cursor(v)          ((v)->type == PUSH_TYPE_CURSOR)
 #define push_val_max(v1, v2, t)       ((v1)->t > (v2)->t ? v1 : v2)
 #define push_val_min(v1, v2, t)       ((v1)->t < (v2)->t ? v1 : v2)
 #define push_val_code_dup(push, val)  push_val_new(push, PUSH_TYPE_CODE, push_code_dup((val)->code))
@@ -54,6 +61,12 @@ typedef struct push_val_S push_val_t;
 #define PUSH_TYPE_INSTR 4
 #define PUSH_TYPE_NAME  5
 #define PUSH_TYPE_REAL  6
+#define PUSH_TYPE_INTVEC  7
+#define PUSH_TYPE_REALVEC 8
+#define PUSH_TYPE_STRING  9
+
+/* Internal: cursor on a stack (see push_cursor_t), never a value */
+#define PUSH_TYPE_CURSOR 0x100
 
 
 /* Dynamic value: Container for different types
@@ -71,6 +84,8 @@ struct push_val_S {
     push_instr_t *instr;
     push_name_t name;
     push_real_t real;
+    push_vec_t *vec;
+    push_str_t *str;
     long _value;
   };
 
@@ -80,9 +95,11 @@ struct push_val_S {
 
 
 push_val_t *push_val_new(push_t *push, int type, ...);
+void push_val_new_array(push_t *push, int type, const void *data, push_int_t n, push_val_t **vals);
 void push_val_destroy(push_val_t *val);
 push_val_t *push_val_copy(push_val_t *val, push_t *to_push);
 push_bool_t push_val_equal(push_val_t *val1, push_val_t *val2);
+guint push_val_hash(push_val_t *val);
 push_val_t *push_val_make_code(push_t *push, push_val_t *val);
 
 
@@ -0,0 +1,64 @@
+/* vec.h - Vectors of integers and reals
+ *
+ * Copyright (c) 2012 Janosch Gräf <janosch.graef@gmx.net>
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef _PUSH_VEC_H_
+#define _PUSH_VEC_H_
+
+
+#include <glib.h>
+
+
+typedef GArray push_vec_t;
+
+
+#include "push/types.h"
+
+
+#define push_vec_ints(vec)   ((push_int_t*)(vec)->data)
+#define push_vec_reals(vec)  ((push_real_t*)(vec)->data)
+
+
+push_vec_t *push_vec_new_int(push_int_t length);
+push_vec_t *push_vec_new_real(push_int_t length);
+push_vec_t *push_vec_dup(push_vec_t *vec);
+push_vec_t *push_vec_slice(push_vec_t *vec, push_int_t start, push_int_t end);
+void push_vec_destroy(push_vec_t *vec);
+
+/* Kernels: dst may be the same as a or b */
+void push_vec_int_add(push_int_t *dst, const push_int_t *a, const push_int_t *b, push_int_t n);
+void push_vec_int_sub(push_int_t *dst, const push_int_t *a, const push_int_t *b, push_int_t n);
+void push_vec_int_mul(push_int_t *dst, const push_int_t *a, const push_int_t *b, push_int_t n);
+void push_vec_int_offset(push_int_t *dst, const push_int_t *a, push_int_t s, push_int_t n);
+void push_vec_int_scale(push_int_t *dst, const push_int_t *a, push_int_t s, push_int_t n);
+push_int_t push_vec_int_dot(const push_int_t *a, const push_int_t *b, push_int_t n);
+push_int_t push_vec_int_sum(const push_int_t *a, push_int_t n);
+
+void push_vec_real_add(push_real_t *dst, const push_real_t *a, const push_real_t *b, push_int_t n);
+void push_vec_real_sub(push_real_t *dst, const push_real_t *a, const push_real_t *b, push_int_t n);
+void push_vec_real_mul(push_real_t *dst, const push_real_t *a, const push_real_t *b, push_int_t n);
+void push_vec_real_offset(push_real_t *dst, const push_real_t *a, push_real_t s, push_int_t n);
+void push_vec_real_scale(push_real_t *dst, const push_real_t *a, push_real_t s, push_int_t n);
+push_real_t push_vec_real_dot(const push_real_t *a, const push_real_t *b, push_int_t n);
+push_real_t push_vec_real_sum(const push_real_t *a, push_int_t n);
+
+
+#endif /* _PUSH_VEC_H_ */
@@ -26,50 +26,362 @@
 
 #include <glib.h>
 
+#ifdef __linux__
+#include <time.h>
+#endif
+
 
 typedef struct push_vm_S push_vm_t;
+typedef struct push_vm_worker_S push_vm_worker_t;
+typedef struct push_vm_process_S push_vm_process_t;
+typedef struct push_vm_future_S push_vm_future_t;
+typedef struct push_vm_waitq_S push_vm_waitq_t;
+typedef struct push_vm_budget_S push_vm_budget_t;
+typedef struct push_vm_histogram_S push_vm_histogram_t;
+typedef struct push_vm_stats_S push_vm_stats_t;
 
 
 #include "push/types.h"
 #include "push/interpreter.h"
+#include "push/pool.h"
 
 
 
 #define PUSH_VM_INTERRUPT_KILL -1
+#define PUSH_VM_INTERRUPT_YIELD -2  /* process gives up its time slice (see push_vm_park) */
+#define PUSH_VM_INTERRUPT_WALL_TIME -3  /* process ran out of wall-clock time (see push_vm_run_budget) */
+#define PUSH_VM_INTERRUPT_CPU_TIME  -4  /* process ran out of CPU time (see push_vm_run_budget) */
+
+/* VM states */
+#define PUSH_VM_STATE_RUNNING 0
+#define PUSH_VM_STATE_FINISH  1  /* workers quit when all processes are done */
+#define PUSH_VM_STATE_DROP    2  /* workers quit, dropping queued processes */
+
+/* Placement of workers
+ * NOTE: Pinning is only done on Linux. Without libnuma (PUSH_USE_NUMA),
+ *       PUSH_VM_PLACEMENT_NUMA is the same as PUSH_VM_PLACEMENT_CORES.
+ */
+#define PUSH_VM_PLACEMENT_NONE  0  /* workers run on any CPU */
+#define PUSH_VM_PLACEMENT_CORES 1  /* each worker is pinned to one CPU */
+#define PUSH_VM_PLACEMENT_NUMA  2  /* workers are spread over NUMA nodes, run on the CPUs of their node and allocate node-local memory */
+
+/* Priority of processes started with push_vm_run */
+#define PUSH_VM_PRIORITY_DEFAULT 1
+
+/* New processes a worker may run before a waiting preempted process */
+#define PUSH_VM_MAX_OVERTAKE 4
+
+/* Interpreters each worker keeps ready in its pool (see push_vm_set_template) */
+#define PUSH_VM_POOL_FILL 16
+
+/* Microseconds between checks of the time budgets of processes */
+#define PUSH_VM_WATCHDOG_INTERVAL 1000
+
+/* Number of buckets of a histogram: bucket i > 0 counts values from 2^(i-1) to 2^i - 1, bucket 0 counts 0 */
+#define PUSH_VM_HISTOGRAM_BUCKETS 64
 
 
 typedef void (*push_vm_done_callback_t)(push_vm_t *vm, push_t *push);
 
 
+/* Future: result of a process submitted with push_vm_run_many
+ * NOTE: Interpreters checked out from the VM (see push_vm_checkout) are
+ *       already reset when their future is done.
+ */
+struct push_vm_future_S {
+  /* reference counter */
+  gint ref_count;
+
+  /* Interpreter */
+  push_t *push;
+
+  /* Steps the process ran */
+  push_int_t steps;
+
+  /* Interrupt flag the process ended with (e.g. PUSH_VM_INTERRUPT_CPU_TIME) */
+  push_int_t interrupt_flag;
+
+  /* Time the process was queued and ran (usec) */
+  gint64 wait_time;
+  gint64 run_time;
+
+  /* If the process is done (see push_vm_future_done) */
+  gint done;
+
+  /* Queue this future is pushed onto when it's done, or NULL */
+  GAsyncQueue *completions;
+};
+
+
+/* Time budget of processes (usec), or 0 for no limit (see push_vm_set_budget) */
+struct push_vm_budget_S {
+  gint64 wall_time;
+  gint64 cpu_time;
+};
+
+
+/* Histogram of values >= 0 with buckets of powers of 2 */
+struct push_vm_histogram_S {
+  guint64 count;
+  gint64 sum;
+  gint64 min;
+  gint64 max;
+  guint64 buckets[PUSH_VM_HISTOGRAM_BUCKETS];
+};
+
+
+/* Scheduling statistics of a worker, or of all workers (see push_vm_get_stats)
+ * NOTE: Times are in microseconds. Histograms have a value per process.
+ */
+struct push_vm_stats_S {
+  /* Number of workers */
+  push_int_t num_workers;
+
+  /* Number of processes done, time slices run and processes stolen from other workers */
+  guint64 processes;
+  guint64 slices;
+  guint64 steals;
+
+  /* Time workers ran processes, and time they existed */
+  gint64 busy_time;
+  gint64 elapsed_time;
+
+  /* Time processes were queued and ran */
+  push_vm_histogram_t wait_time;
+  push_vm_histogram_t run_time;
+
+  /* Steps processes ran, and steps per second while they ran */
+  push_vm_histogram_t steps;
+  push_vm_histogram_t speed;
+};
+
+
+/* Wait queue: something processes can wait for (see push_vm_park)
+ * NOTE: Waiting processes are kept by the wait queue, so a signal only looks
+ *       at them, and without any it doesn't even take the lock.
+ */
+struct push_vm_waitq_S {
+  /* number of signals so far */
+  gint signals;
+
+  /* Waiting processes of all VMs: push_vm_process_t (protected by mutex) */
+  GQueue *waiting;
+  gint num_waiting;
+
+  /* VMs that know this queue: push_vm_t (protected by mutex) */
+  GSList *vms;
+
+  /* mutex */
+  GMutex *mutex;
+};
+
+
+/* Process: interpreter with its scheduling state */
+struct push_vm_process_S {
+  /* VM running the process */
+  push_vm_t *vm;
+
+  /* Interpreter */
+  push_t *push;
+
+  /* Priority: number of quanta per time slice */
+  push_int_t priority;
+
+  /* Steps run so far */
+  push_int_t steps;
+
+  /* Future, or NULL */
+  push_vm_future_t *future;
+
+  /* Wait queue while parked, or NULL */
+  push_vm_waitq_t *waitq;
+
+  /* Monotonic time when the process runs out of wall-clock time, or 0 */
+  gint64 deadline;
+
+  /* CPU time the process may use and has used so far (usec), max_cpu_time is 0 for no limit */
+  gint64 max_cpu_time;
+  gint64 cpu_time;
+
+  /* Monotonic time when the process was queued last, time it was queued and ran so far */
+  gint64 queued_time;
+  gint64 wait_time;
+  gint64 run_time;
+};
+
+
+/* Worker thread with its own queues of processes
+ * NOTE: A worker takes processes from the head of its own queues. When they
+ *       are empty, it steals the oldest new process or the most recently
+ *       preempted one from another worker.
+ */
+struct push_vm_worker_S {
+  /* VM of this worker */
+  push_vm_t *vm;
+
+  /* Index in the VM's workers */
+  push_int_t index;
+
+  /* Thread */
+  GThread *thread;
+
+  /* Queued processes: push_vm_process_t
+   * NOTE: New processes wait in fresh, preempted ones in queue, both in
+   *       order of arrival (see PUSH_VM_MAX_OVERTAKE).
+   */
+  GQueue *fresh;
+  GQueue *queue;
+
+  /* New processes taken in a row while a preempted one was waiting (protected by mutex) */
+  push_int_t overtaken;
+
+  /* Mutex for the queue */
+  GMutex *mutex;
+
+  /* Interpreters checked out from this worker, or NULL
+   * NOTE: their processes are queued at this worker
+   */
+  push_pool_t *pool;
+
+  /* Whether the pool was just set and must be filled (protected by the VM's idle_mutex) */
+  gint fill_pool;
+
+  /* Running process, or NULL (protected by mutex) */
+  push_vm_process_t *current;
+
+  /* Wait queue the running process wants to wait for, or NULL (see push_vm_park) */
+  push_vm_waitq_t *park;
+  gint park_signals;
+
+  /* Statistics (protected by mutex, except steals) */
+  push_vm_stats_t stats;
+  gint steals;
+
+  /* Monotonic time when the statistics were reset */
+  gint64 stats_time;
+
+  /* CPU time of the worker when the running process started its slice (protected by mutex) */
+  gint64 slice_cpu_time;
+#ifdef __linux__
+  clockid_t cpu_clock;
+#endif
+
+  /* CPU and NUMA node the worker runs on, or -1 */
+  push_int_t cpu;
+  push_int_t node;
+};
+
+
 struct push_vm_S {
-  /* Processes: push_t */
-  GList *processes;
+  /* Placement of workers (PUSH_VM_PLACEMENT_*) */
+  push_int_t placement;
+
+  /* Number of processes that aren't done yet */
+  gint num_processes;
+
+  /* Number of processes waiting in a wait queue */
+  gint num_parked;
+
+  /* Wait queues this VM's processes waited for: push_vm_waitq_t (protected by mutex)
+   * NOTE: The VM must be destroyed before them.
+   */
+  GSList *waitqs;
 
-  /* Thread pool for running processes */
-  GThreadPool *threads;
+  /* Workers */
+  push_vm_worker_t *workers;
+  push_int_t num_workers;
+
+  /* Worker for the next process submitted by other threads (round robin) */
+  gint next_worker;
+
+  /* Number of queued processes (in all workers) */
+  gint num_queued;
+
+  /* Number of workers waiting for processes */
+  gint num_idle;
+
+  /* State (PUSH_VM_STATE_*) */
+  gint state;
+
+  /* Mutex & condition for idle workers */
+  GMutex *idle_mutex;
+  GCond *idle_cond;
 
   /* Max number of steps per process */
   push_int_t max_steps;
 
-  /* Callback when process is done */
+  /* Steps per quantum, or 0 to run processes to completion
+   * NOTE: With time slicing, a worker preempts a process after priority
+   *       quanta and continues it after the other processes in its queue.
+   */
+  push_int_t quantum;
+
+  /* Time budget of new processes, read without a lock
+   * NOTE: push_vm_set_budget replaces it as a whole and keeps the old ones
+   *       in old_budgets (protected by mutex) until the VM is destroyed.
+   */
+  push_vm_budget_t *budget;
+  GSList *old_budgets;
+
+  /* Thread that interrupts processes over their time budget, or NULL
+   * NOTE: It's only started when a process has a budget.
+   */
+  GThread *watchdog;
+  gint watchdog_quit;
+
+  /* Callback when process is done
+   * NOTE: The interrupt flag of the interpreter tells why the process ended
+   *       (e.g. PUSH_VM_INTERRUPT_WALL_TIME), or is 0.
+   */
   push_vm_done_callback_t done_callback;
 
   /* Mutex */
   GMutex *mutex;
 
-  /* Condition for waiting until all processes are done */
+  /* Condition for waiting threads, if there are no futexes */
   GCond *wait_cond;
+
+  /* Number of threads waiting for all processes or a future
+   * NOTE: done processes only wake up threads if there are any
+   */
+  gint num_waiters;
+
+  /* eventfd signalled for each done process, or -1 (see push_vm_get_eventfd) */
+  gint eventfd;
 };
 
 
+push_vm_t *push_vm_new_full(push_int_t num_threads, push_int_t max_steps, push_vm_done_callback_t done_callback, push_int_t placement);
 push_vm_t *push_vm_new(push_int_t num_threads, push_int_t max_steps, push_vm_done_callback_t done_callback);
 void push_vm_destroy(push_vm_t *vm, push_bool_t kill_all);
 void push_vm_run(push_vm_t *vm, push_t *push);
+void push_vm_run_priority(push_vm_t *vm, push_t *push, push_int_t priority);
+void push_vm_run_budget(push_vm_t *vm, push_t *push, push_int_t priority, gint64 wall_time, gint64 cpu_time);
+void push_vm_set_quantum(push_vm_t *vm, push_int_t quantum);
+void push_vm_set_budget(push_vm_t *vm, gint64 wall_time, gint64 cpu_time);
+void push_vm_set_template(push_vm_t *vm, push_template_t *template);
+push_t *push_vm_checkout(push_vm_t *vm);
 push_int_t push_vm_num_processes(push_vm_t *vm);
 push_int_t push_vm_num_queued(push_vm_t *vm);
 void push_vm_interrupt_all(push_vm_t *vm, push_int_t interrupt_flag);
 void push_vm_kill_all(push_vm_t *vm);
 void push_vm_wait(push_vm_t *vm);
+int push_vm_get_eventfd(push_vm_t *vm);
+push_vm_future_t **push_vm_run_many(push_vm_t *vm, push_t **pushes, push_int_t n, GAsyncQueue *completions);
+push_vm_future_t *push_vm_future_ref(push_vm_future_t *future);
+void push_vm_future_unref(push_vm_future_t *future);
+push_bool_t push_vm_future_done(push_vm_future_t *future);
+void push_vm_future_wait(push_vm_t *vm, push_vm_future_t *future);
+push_vm_waitq_t *push_vm_waitq_new(void);
+void push_vm_waitq_destroy(push_vm_waitq_t *waitq);
+void push_vm_waitq_signal(push_vm_waitq_t *waitq);
+void push_vm_park(push_t *push, push_vm_waitq_t *waitq, gint signals);
+push_vm_stats_t *push_vm_get_stats(push_vm_t *vm, push_int_t worker);
+void push_vm_reset_stats(push_vm_t *vm);
+void push_vm_stats_destroy(push_vm_stats_t *stats);
+push_real_t push_vm_stats_utilization(push_vm_stats_t *stats);
+push_real_t push_vm_histogram_mean(push_vm_histogram_t *histogram);
+gint64 push_vm_histogram_percentile(push_vm_histogram_t *histogram, push_real_t percentile);
 
 
 #endif /* _PUSH_VM_H_ */
@@ -20,28 +20,750 @@
  * IN THE SOFTWARE.
  */
 
+#include <string.h>
+
 #include <glib.h>
 
 #include "push.h"
 
 
-void push_instr_reg(push_t *push, const char *name, push_instr_func_t func, void *userdata) {
+push_instrset_t *push_instrset_new(void) {
+  push_instrset_t *instrs;
+
+  instrs = g_slice_new(push_instrset_t);
+  instrs->ref_count = 1;
+  instrs->parent = NULL;
+  instrs->by_name = g_hash_table_new(g_str_hash, g_str_equal);
+  instrs->by_opcode = g_ptr_array_new();
+  instrs->owned = g_ptr_array_new();
+  instrs->weights = g_array_new(FALSE, FALSE, sizeof(gdouble));
+  instrs->included = g_array_new(FALSE, FALSE, sizeof(gboolean));
+  instrs->alias_prob = g_array_new(FALSE, FALSE, sizeof(gdouble));
+  instrs->alias = g_array_new(FALSE, FALSE, sizeof(push_int_t));
+  instrs->sampler_valid = FALSE;
+
+  return instrs;
+}
+
+
+/* lock for building sampling tables of shared instruction sets */
+static GStaticMutex push_instrset_sampler_mutex = G_STATIC_MUTEX_INIT;
+
+
+/* build tables for sampling instructions by weight with Vose's alias method
+ * NOTE: afterwards each opcode i is kept with probability alias_prob[i] and
+ *       otherwise replaced by alias[i]
+ */
+static void push_instrset_build_sampler(push_instrset_t *instrs) {
+  push_int_t n, i, s, l, n_small, n_large;
+  push_int_t *small, *large;
+  gdouble sum, *p;
+
+  n = (push_int_t)instrs->weights->len;
+  g_array_set_size(instrs->alias_prob, 0);
+  g_array_set_size(instrs->alias, 0);
+
+  /* NOTE: instructions that aren't included have weight 0 */
+  p = g_new(gdouble, n);
+  sum = 0.0;
+  for (i = 0; i < n; i++) {
+    p[i] = g_array_index(instrs->included, gboolean, i) ? g_array_index(instrs->weights, gdouble, i) : 0.0;
+    sum += p[i];
+  }
+
+  if (sum <= 0.0) {
+    /* nothing to sample from */
+    g_free(p);
+    return;
+  }
+
+  g_array_set_size(instrs->alias_prob, n);
+  g_array_set_size(instrs->alias, n);
+  small = g_new(push_int_t, n);
+  large = g_new(push_int_t, n);
+  n_small = 0;
+  n_large = 0;
+  l = 0;
+
+  /* scale weights so that their mean is 1 */
+  for (i = 0; i < n; i++) {
+    p[i] = p[i] * n / sum;
+    if (p[i] < 1.0) {
+      small[n_small++] = i;
+    }
+    else {
+      large[n_large++] = i;
+    }
+  }
+
+  /* fill up each small entry with a large one */
+  while (n_small > 0 && n_large > 0) {
+    s = small[--n_small];
+    l = large[--n_large];
+
+    g_array_index(instrs->alias_prob, gdouble, s) = p[s];
+    g_array_index(instrs->alias, push_int_t, s) = l;
+
+    p[l] = (p[l] + p[s]) - 1.0;
+    if (p[l] < 1.0) {
+      small[n_small++] = l;
+    }
+    else {
+      large[n_large++] = l;
+    }
+  }
+
+  /* remaining entries are full (up to rounding errors) */
+  while (n_large > 0) {
+    l = large[--n_large];
+    g_array_index(instrs->alias_prob, gdouble, l) = 1.0;
+    g_array_index(instrs->alias, push_int_t, l) = l;
+  }
+  /* NOTE: entries with weight 0 are always replaced (l was set above, since
+   *       there's at least one large entry)
+   */
+  while (n_small > 0) {
+    s = small[--n_small];
+    g_array_index(instrs->alias_prob, gdouble, s) = p[s] > 0.0 ? 1.0 : 0.0;
+    g_array_index(instrs->alias, push_int_t, s) = p[s] > 0.0 ? s : l;
+  }
+
+  g_free(p);
+  g_free(small);
+  g_free(large);
+}
+
+
+/* copy instruction set, so it can be changed
+ * NOTE: the copy refers to the instructions of the original, so instruction
+ *       pointers and opcodes stay valid
+ */
+push_instrset_t *push_instrset_copy(push_instrset_t *instrs) {
+  push_instrset_t *new_instrs;
   push_instr_t *instr;
+  guint i;
 
-  g_return_if_null(push);
-  g_return_if_null(name);
-  g_return_if_null(func);
+  g_return_val_if_null(instrs, NULL);
+
+  new_instrs = push_instrset_new();
+  new_instrs->parent = push_instrset_ref(instrs);
+
+  for (i = 0; i < instrs->by_opcode->len; i++) {
+    instr = (push_instr_t*)g_ptr_array_index(instrs->by_opcode, i);
+    g_ptr_array_add(new_instrs->by_opcode, instr);
+    g_hash_table_insert(new_instrs->by_name, instr->name, instr);
+  }
+
+  g_array_append_vals(new_instrs->weights, instrs->weights->data, instrs->weights->len);
+  g_array_append_vals(new_instrs->included, instrs->included->data, instrs->included->len);
+  new_instrs->sampler_valid = FALSE;
+
+  return new_instrs;
+}
+
+
+push_instrset_t *push_instrset_ref(push_instrset_t *instrs) {
+  g_return_val_if_null(instrs, NULL);
+
+  g_atomic_int_inc(&instrs->ref_count);
+
+  return instrs;
+}
+
+
+void push_instrset_unref(push_instrset_t *instrs) {
+  g_return_if_null(instrs);
+
+  if (g_atomic_int_dec_and_test(&instrs->ref_count)) {
+    g_ptr_array_foreach(instrs->owned, (GFunc)push_instr_destroy, NULL);
+    g_ptr_array_free(instrs->owned, TRUE);
+    g_ptr_array_free(instrs->by_opcode, TRUE);
+    g_array_free(instrs->weights, TRUE);
+    g_array_free(instrs->included, TRUE);
+    g_array_free(instrs->alias_prob, TRUE);
+    g_array_free(instrs->alias, TRUE);
+    g_hash_table_destroy(instrs->by_name);
+
+    if (instrs->parent != NULL) {
+      push_instrset_unref(instrs->parent);
+    }
+
+    g_slice_free(push_instrset_t, instrs);
+  }
+}
+
+
+/* register instruction in set
+ * NOTE: an instruction with the same name is replaced, but keeps its opcode
+ *       and weight. New instructions have weight 1. Either way the
+ *       instruction is included (see push_instrset_select).
+ */
+push_instr_t *push_instrset_reg(push_instrset_t *instrs, const char *name, push_instr_func_t func, void *userdata, gssize stack) {
+  push_instr_t *instr, *old_instr;
+  gdouble weight = 1.0;
+  gboolean included = TRUE;
+
+  g_return_val_if_null(instrs, NULL);
+  g_return_val_if_null(name, NULL);
+  g_return_val_if_null(func, NULL);
+
+  old_instr = (push_instr_t*)g_hash_table_lookup(instrs->by_name, name);
 
   instr = g_slice_new(push_instr_t);
-  instr->name = push_intern_name(push, name);
+  instr->name = old_instr != NULL ? old_instr->name : push_name_intern(name);
+  instr->opcode = old_instr != NULL ? old_instr->opcode : (push_int_t)instrs->by_opcode->len;
   instr->func = func;
   instr->userdata = userdata;
+  instr->stack = stack;
+  instr->flags = 0;
+  instr->parts = NULL;
+  instr->effect = NULL;
+  instr->unchecked = NULL;
+
+  if (old_instr != NULL) {
+    g_ptr_array_index(instrs->by_opcode, instr->opcode) = instr;
+    g_array_index(instrs->included, gboolean, instr->opcode) = TRUE;
+  }
+  else {
+    g_ptr_array_add(instrs->by_opcode, instr);
+    g_array_append_val(instrs->weights, weight);
+    g_array_append_val(instrs->included, included);
+  }
+  instrs->sampler_valid = FALSE;
+  g_hash_table_insert(instrs->by_name, instr->name, instr);
+  g_ptr_array_add(instrs->owned, instr);
+
+  return instr;
+}
+
+
+/* NOTE: returns NULL for instructions that aren't included */
+push_instr_t *push_instrset_lookup(push_instrset_t *instrs, const char *name) {
+  push_instr_t *instr;
+
+  g_return_val_if_null(instrs, NULL);
+  g_return_val_if_null(name, NULL);
+
+  instr = (push_instr_t*)g_hash_table_lookup(instrs->by_name, name);
+
+  return instr != NULL && g_array_index(instrs->included, gboolean, instr->opcode) ? instr : NULL;
+}
+
+
+/* NOTE: returns NULL for instructions that aren't included */
+push_instr_t *push_instrset_get(push_instrset_t *instrs, push_int_t opcode) {
+  g_return_val_if_null(instrs, NULL);
+
+  if (opcode < 0 || opcode >= (push_int_t)instrs->by_opcode->len || !g_array_index(instrs->included, gboolean, opcode)) {
+    return NULL;
+  }
+
+  return (push_instr_t*)g_ptr_array_index(instrs->by_opcode, opcode);
+}
+
+
+/* run all parts of a superinstruction
+ * NOTE: if the stacks are deep enough for all parts, they're run without
+ *       checking each of them
+ */
+static void push_instr_call_parts(push_t *push, push_instr_t *instr) {
+  push_instr_t **part;
+
+  if (instr->unchecked != NULL && push_instr_effect_check(push, instr->effect)) {
+    for (part = instr->parts; *part != NULL; part++) {
+      (*part)->unchecked(push, (*part)->stack < 0 ? (*part)->userdata : G_STRUCT_MEMBER(push_stack_t*, push, (*part)->stack));
+    }
+  }
+  else {
+    for (part = instr->parts; *part != NULL; part++) {
+      push_instr_call(push, *part);
+    }
+  }
+}
+
+
+/* combine effects of the parts of a superinstruction, if all have one */
+static void push_instr_effect_parts(push_instr_t *instr) {
+  push_instr_effect_t *effect;
+  push_instr_t **part;
+  push_int_t i, depth, depth_max;
+  push_bool_t unchecked = TRUE;
+
+  for (part = instr->parts; *part != NULL; part++) {
+    if ((*part)->effect == NULL) {
+      return;
+    }
+    unchecked = unchecked && (*part)->unchecked != NULL;
+  }
+
+  effect = g_slice_new0(push_instr_effect_t);
+
+  for (i = 0; i < PUSH_STACK_NUM; i++) {
+    /* depth relative to the start (at least & at most) */
+    depth = 0;
+    depth_max = 0;
+
+    for (part = instr->parts; *part != NULL; part++) {
+      effect->pops[i] = MAX(effect->pops[i], (*part)->effect->pops[i] - depth);
+      depth += (*part)->effect->pushes[i] - (*part)->effect->pops[i];
+      depth_max += (*part)->effect->pushes_max[i] - (*part)->effect->pops[i];
+    }
+
+    effect->pushes[i] = effect->pops[i] + depth;
+    effect->pushes_max[i] = effect->pops[i] + depth_max;
+  }
+
+  instr->effect = effect;
+
+  /* NOTE: this is only used by push_instr_call_parts */
+  if (unchecked) {
+    instr->unchecked = instr->func;
+  }
+}
+
+
+/* register superinstruction, that runs n instructions of the set in a single
+ * dispatch
+ * NOTE: it's named after its parts (separated by spaces) and has weight 0,
+ *       so it isn't chosen by push_instrset_sample
+ */
+push_instr_t *push_instrset_reg_super(push_instrset_t *instrs, push_instr_t **parts, push_int_t n) {
+  push_instr_t *instr;
+  GString *name;
+  push_int_t i;
+
+  g_return_val_if_null(instrs, NULL);
+  g_return_val_if_null(parts, NULL);
+  g_return_val_if_fail(n > 1, NULL);
+
+  name = g_string_new(NULL);
+  for (i = 0; i < n; i++) {
+    g_return_val_if_fail(parts[i]->flags & PUSH_INSTR_FUSABLE, NULL);
+    g_string_append_printf(name, i == 0 ? "%s" : " %s", parts[i]->name);
+  }
+
+  instr = push_instrset_lookup(instrs, name->str);
+  if (instr == NULL) {
+    instr = push_instrset_reg(instrs, name->str, (push_instr_func_t)push_instr_call_parts, NULL, -1);
+    instr->userdata = instr;
+    instr->flags = PUSH_INSTR_FUSABLE;
+    instr->parts = g_new0(push_instr_t*, n + 1);
+    memcpy(instr->parts, parts, n * sizeof(push_instr_t*));
+    push_instr_effect_parts(instr);
+
+    g_array_index(instrs->weights, gdouble, instr->opcode) = 0.0;
+    instrs->sampler_valid = FALSE;
+  }
+
+  g_string_free(name, TRUE);
+
+  return instr;
+}
+
+
+push_int_t push_instrset_length(push_instrset_t *instrs) {
+  g_return_val_if_null(instrs, 0);
+
+  return (push_int_t)instrs->by_opcode->len;
+}
+
+
+/* Returns instructions of the set matching pattern: the instruction named
+ * pattern if there is one, otherwise all instructions whose names match
+ * the wildcards (as in g_pattern_match_simple)
+ * NOTE: Names like INT.* are names of instructions, not wildcards. Free the
+ *       result with g_ptr_array_free.
+ */
+static GPtrArray *push_instrset_match(push_instrset_t *instrs, const char *pattern) {
+  GPtrArray *matches;
+  push_instr_t *instr;
+  guint i;
+
+  matches = g_ptr_array_new();
+
+  instr = (push_instr_t*)g_hash_table_lookup(instrs->by_name, pattern);
+  if (instr != NULL) {
+    g_ptr_array_add(matches, instr);
+    return matches;
+  }
+
+  for (i = 0; i < instrs->by_opcode->len; i++) {
+    instr = (push_instr_t*)g_ptr_array_index(instrs->by_opcode, i);
+    if (g_pattern_match_simple(pattern, instr->name)) {
+      g_ptr_array_add(matches, instr);
+    }
+  }
+
+  return matches;
+}
+
+
+/* Includes only instructions matching one of the patterns (NULL-terminated,
+ * see push_instrset_match) in the set
+ * NOTE: Instructions that aren't included keep their opcode and stay
+ *       valid, but can't be looked up or sampled. Patterns are matched
+ *       against all instructions of the set, so they can include
+ *       instructions again. Superinstructions are left out.
+ */
+void push_instrset_select(push_instrset_t *instrs, const char **patterns) {
+  GPtrArray *matches;
+  push_instr_t *instr;
+  guint i, j;
+
+  g_return_if_null(instrs);
+  g_return_if_null(patterns);
+
+  for (i = 0; i < instrs->included->len; i++) {
+    g_array_index(instrs->included, gboolean, i) = FALSE;
+  }
+
+  for (i = 0; patterns[i] != NULL; i++) {
+    matches = push_instrset_match(instrs, patterns[i]);
+    for (j = 0; j < matches->len; j++) {
+      instr = (push_instr_t*)g_ptr_array_index(matches, j);
+      if (instr->parts == NULL) {
+        g_array_index(instrs->included, gboolean, instr->opcode) = TRUE;
+      }
+    }
+    g_ptr_array_free(matches, TRUE);
+  }
+
+  instrs->sampler_valid = FALSE;
+}
+
+
+/* Returns new set with the instructions matching one of the patterns
+ * (see push_instrset_select)
+ * NOTE: the instructions keep their opcodes and weights
+ */
+push_instrset_t *push_instrset_subset(push_instrset_t *instrs, const char **patterns) {
+  push_instrset_t *new_instrs;
+
+  g_return_val_if_null(instrs, NULL);
+  g_return_val_if_null(patterns, NULL);
+
+  new_instrs = push_instrset_copy(instrs);
+  push_instrset_select(new_instrs, patterns);
+
+  return new_instrs;
+}
+
+
+/* Set sampling weight of the instructions matching pattern (see
+ * push_instrset_match)
+ * NOTE: Returns number of matched instructions. A weight of 0 excludes
+ *       instructions from sampling.
+ */
+push_int_t push_instrset_set_weight(push_instrset_t *instrs, const char *pattern, gdouble weight) {
+  GPtrArray *matches;
+  push_int_t n;
+  guint i;
+
+  g_return_val_if_null(instrs, 0);
+  g_return_val_if_null(pattern, 0);
+  g_return_val_if_fail(weight >= 0.0, 0);
+
+  matches = push_instrset_match(instrs, pattern);
+  for (i = 0; i < matches->len; i++) {
+    g_array_index(instrs->weights, gdouble, ((push_instr_t*)g_ptr_array_index(matches, i))->opcode) = weight;
+  }
+  n = matches->len;
+  g_ptr_array_free(matches, TRUE);
+
+  if (n > 0) {
+    instrs->sampler_valid = FALSE;
+  }
+
+  return n;
+}
+
+
+/* Returns random instruction, chosen according to the weights in O(1)
+ * NOTE: The sampling tables are built on the first sample after the
+ *       weights changed, so building a set stays linear.
+ */
+push_instr_t *push_instrset_sample(push_instrset_t *instrs, GRand *rand) {
+  push_int_t i;
+
+  g_return_val_if_null(instrs, NULL);
+  g_return_val_if_null(rand, NULL);
+
+  /* NOTE: shared sets are sampled by several threads */
+  if (!g_atomic_int_get(&instrs->sampler_valid)) {
+    g_static_mutex_lock(&push_instrset_sampler_mutex);
+    if (!instrs->sampler_valid) {
+      push_instrset_build_sampler(instrs);
+      g_atomic_int_set(&instrs->sampler_valid, TRUE);
+    }
+    g_static_mutex_unlock(&push_instrset_sampler_mutex);
+  }
+
+  if (instrs->alias->len == 0) {
+    return NULL;
+  }
+
+  i = (push_int_t)g_rand_int_range(rand, 0, (gint32)instrs->alias->len);
+  if (g_rand_double(rand) >= g_array_index(instrs->alias_prob, gdouble, i)) {
+    i = g_array_index(instrs->alias, push_int_t, i);
+  }
+
+  return (push_instr_t*)g_ptr_array_index(instrs->by_opcode, i);
+}
+
+
+/* Returns interpreter's instruction set, so that it can be changed
+ * NOTE: copies the set first, if it's shared with other interpreters
+ */
+push_instrset_t *push_instr_unshare(push_t *push) {
+  push_instrset_t *instrs;
+
+  g_return_val_if_null(push, NULL);
+
+  if (g_atomic_int_get(&push->instructions->ref_count) > 1) {
+    instrs = push_instrset_copy(push->instructions);
+    push_instrset_unref(push->instructions);
+    push->instructions = instrs;
+  }
+
+  return push->instructions;
+}
+
+
+/* offsets of the stacks in push_t, by PUSH_STACK_* */
+static const gsize push_instr_stacks[PUSH_STACK_NUM] = {
+  G_STRUCT_OFFSET(push_t, boolean),
+  G_STRUCT_OFFSET(push_t, code),
+  G_STRUCT_OFFSET(push_t, exec),
+  G_STRUCT_OFFSET(push_t, integer),
+  G_STRUCT_OFFSET(push_t, name),
+  G_STRUCT_OFFSET(push_t, real),
+  G_STRUCT_OFFSET(push_t, intvec),
+  G_STRUCT_OFFSET(push_t, realvec),
+  G_STRUCT_OFFSET(push_t, string)
+};
+
+/* stack letters in effect strings, by PUSH_STACK_* */
+static const char push_instr_stack_letters[] = "bceinrvws";
+
+
+/* Returns stack i (PUSH_STACK_*) of interpreter */
+push_stack_t *push_instr_get_stack(push_t *push, push_int_t i) {
+  g_return_val_if_null(push, NULL);
+  g_return_val_if_fail(i >= 0 && i < PUSH_STACK_NUM, NULL);
+
+  return G_STRUCT_MEMBER(push_stack_t*, push, push_instr_stacks[i]);
+}
+
+
+/* Set stack effect of instruction
+ * NOTE: effect is written as the stack letters of all values taken, a ">",
+ *       and the stack letters of all values pushed, e.g. "ii>b" for INT.<.
+ *       "*" is the stack of a poly instruction and a "?" after a pushed value
+ *       means it isn't always pushed. unchecked may be NULL.
+ */
+push_bool_t push_instr_set_effect(push_instr_t *instr, const char *effect, push_instr_func_t unchecked) {
+  push_instr_effect_t *new_effect;
+  push_bool_t pushed = FALSE;
+  const char *c, *letter;
+  push_int_t i = -1;
+
+  g_return_val_if_null(instr, FALSE);
+  g_return_val_if_null(effect, FALSE);
+
+  new_effect = g_slice_new0(push_instr_effect_t);
+
+  for (c = effect; *c != '\0'; c++) {
+    if (*c == '>') {
+      pushed = TRUE;
+      continue;
+    }
+    else if (*c == '?' && pushed && i >= 0) {
+      /* last pushed value is optional */
+      new_effect->pushes[i]--;
+      continue;
+    }
+
+    /* find stack */
+    i = -1;
+    if (*c == '*') {
+      for (i = PUSH_STACK_NUM - 1; i >= 0 && (gssize)push_instr_stacks[i] != instr->stack; i--);
+    }
+    else if ((letter = strchr(push_instr_stack_letters, *c)) != NULL) {
+      i = letter - push_instr_stack_letters;
+    }
+
+    if (i < 0) {
+      g_warning("Invalid stack effect for %s: %s", instr->name, effect);
+      g_slice_free(push_instr_effect_t, new_effect);
+      return FALSE;
+    }
+
+    if (pushed) {
+      new_effect->pushes[i]++;
+      new_effect->pushes_max[i]++;
+    }
+    else {
+      new_effect->pops[i]++;
+    }
+  }
+
+  if (instr->effect != NULL) {
+    g_slice_free(push_instr_effect_t, instr->effect);
+  }
+  instr->effect = new_effect;
+  instr->unchecked = unchecked;
+
+  return TRUE;
+}
+
+
+/* Returns if the stacks of interpreter are deep enough for effect */
+push_bool_t push_instr_effect_check(push_t *push, push_instr_effect_t *effect) {
+  push_int_t i;
+
+  for (i = 0; i < PUSH_STACK_NUM; i++) {
+    if (effect->pops[i] > 0 && push_stack_length(push_instr_get_stack(push, i)) < effect->pops[i]) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+
+/* Static analysis: given bounds lo[i] <= depth of stack i <= hi[i] (with
+ * G_MAXINT for unbounded), returns if instr certainly runs (PUSH_INSTR_RUNS),
+ * certainly does nothing (PUSH_INSTR_NOOP) or either (PUSH_INSTR_MAYBE) and
+ * updates the bounds for after it
+ * NOTE: instructions without an effect may do anything to any stack
+ */
+push_int_t push_instr_effect_step(push_instr_t *instr, push_int_t *lo, push_int_t *hi) {
+  push_instr_effect_t *effect;
+  push_int_t i, run_lo, run_hi, result = PUSH_INSTR_RUNS;
+
+  g_return_val_if_null(instr, PUSH_INSTR_MAYBE);
+
+  effect = instr->effect;
+  if (effect == NULL) {
+    for (i = 0; i < PUSH_STACK_NUM; i++) {
+      lo[i] = 0;
+      hi[i] = G_MAXINT;
+    }
+    return PUSH_INSTR_MAYBE;
+  }
+
+  for (i = 0; i < PUSH_STACK_NUM; i++) {
+    if (hi[i] < effect->pops[i]) {
+      return PUSH_INSTR_NOOP;
+    }
+    else if (lo[i] < effect->pops[i]) {
+      result = PUSH_INSTR_MAYBE;
+    }
+  }
+
+  for (i = 0; i < PUSH_STACK_NUM; i++) {
+    run_lo = MAX(lo[i], effect->pops[i]) - effect->pops[i] + effect->pushes[i];
+    run_hi = hi[i] == G_MAXINT ? G_MAXINT : hi[i] - effect->pops[i] + effect->pushes_max[i];
+
+    /* if it may not run, the old bounds stay possible */
+    if (result == PUSH_INSTR_RUNS) {
+      lo[i] = run_lo;
+      hi[i] = run_hi;
+    }
+    else {
+      lo[i] = MIN(lo[i], run_lo);
+      hi[i] = MAX(hi[i], run_hi);
+    }
+  }
+
+  return result;
+}
+
+
+/* Returns instruction name or pattern given by a configuration value */
+static const char *push_instr_config_pattern(push_val_t *val) {
+  if (push_check_name(val)) {
+    return val->name;
+  }
+  else if (push_check_instr(val)) {
+    return val->instr->name;
+  }
+  else {
+    g_warning("Instruction name in configuration must be a name or an instruction");
+    return NULL;
+  }
+}
+
+
+/* Load instruction subset and weights from configuration
+ * NOTE: INSTRUCTIONS is a list of names of the instructions to keep, which
+ *       may contain wildcards (e.g. EXEC.*, but INT.* is multiplication, see
+ *       push_instrset_match). INSTRUCTION-WEIGHTS is a list of such names,
+ *       each followed by its weight (INT or REAL). Without these values the
+ *       (shared) instruction set stays as it is. push_config_set calls this
+ *       when either value is set. Instructions are only left out of the
+ *       set, so they stay valid (see push_instrset_select).
+ */
+void push_instr_load_config(push_t *push) {
+  push_val_t *val, *weight;
+  push_instrset_t *instrs;
+  const char **patterns;
+  const char *pattern;
+  GList *link;
+  int i;
+
+  g_return_if_null(push);
+
+  val = push_config_get(push, "INSTRUCTIONS");
+  if (val != NULL && push_check_code(val)) {
+    patterns = g_new0(const char*, val->code->length + 1);
+    i = 0;
+    for (link = val->code->head; link != NULL; link = link->next) {
+      pattern = push_instr_config_pattern((push_val_t*)link->data);
+      if (pattern != NULL) {
+        patterns[i++] = pattern;
+      }
+    }
+
+    push_instrset_select(push_instr_unshare(push), patterns);
+
+    g_free(patterns);
+  }
+
+  val = push_config_get(push, "INSTRUCTION-WEIGHTS");
+  if (val != NULL && push_check_code(val)) {
+    instrs = push_instr_unshare(push);
+
+    for (link = val->code->head; link != NULL && link->next != NULL; link = link->next->next) {
+      pattern = push_instr_config_pattern((push_val_t*)link->data);
+      weight = (push_val_t*)link->next->data;
+
+      if (pattern != NULL && push_check_int(weight)) {
+        push_instrset_set_weight(instrs, pattern, (gdouble)weight->integer);
+      }
+      else if (pattern != NULL && push_check_real(weight)) {
+        push_instrset_set_weight(instrs, pattern, weight->real);
+      }
+      else {
+        g_warning("Instruction weight in configuration must be an integer or a real number");
+      }
+    }
+  }
+}
+
+
+void push_instr_reg(push_t *push, const char *name, push_instr_func_t func, void *userdata) {
+  g_return_if_null(push);
 
-  g_hash_table_insert(push->instructions, instr->name, instr);
+  push_instrset_reg(push_instr_unshare(push), name, func, userdata, -1);
 }
 
 
 void push_instr_destroy(push_instr_t *instr) {
+  g_free(instr->parts);
+  if (instr->effect != NULL) {
+    g_slice_free(push_instr_effect_t, instr->effect);
+  }
   g_slice_free(push_instr_t, instr);
 }
 
@@ -49,13 +771,14 @@ void push_instr_destroy(push_instr_t *instr) {
 push_instr_t *push_instr_lookup(push_t *push, const char *name) {
   g_return_val_if_null(push, NULL);
 
-  return (push_instr_t*)g_hash_table_lookup(push->instructions, push_intern_name(push, name));
+  return push_instrset_lookup(push->instructions, name);
 }
 
 
-void push_call_instr(push_t *push, push_instr_t *instr) {
+void push_instr_call(push_t *push, push_instr_t *instr) {
   g_return_if_null(instr);
 
-  instr->func(push, instr->userdata);
+  /* poly instructions get the stack of this interpreter */
+  instr->func(push, instr->stack < 0 ? instr->userdata : G_STRUCT_MEMBER(push_stack_t*, push, instr->stack));
 }
 
@@ -20,12 +20,167 @@
  * IN THE SOFTWARE.
  */
 
+#include <string.h>
+
 #include <glib.h>
 
 #include "push.h"
 
 
 
+/* initial (and minimum) number of slots of the bindings table */
+#define PUSH_BINDINGS_MIN_SIZE 16
+
+/* whether a binding is valid */
+#define push_binding_is_valid(push, binding) ((binding)->val != NULL && (binding)->generation == (push)->generation)
+
+/* first slot to probe for a name
+ * NOTE: ids are dense (or count down for generated names), so they're
+ *       already spread over the table
+ */
+#define push_binding_hash(push, name) ((guint)push_name_id(name) & ((push)->bindings_size - 1))
+
+/* whether configuration or bindings are still shared with the template */
+#define push_shares_config(push) ((push)->template != NULL && (push)->config == (push)->template->push->config)
+#define push_shares_bindings(push) ((push)->template != NULL && (push)->bindings == (push)->template->push->bindings)
+
+
+/* Makes configuration of interpreter its own, before it's changed
+ * NOTE: values are shared, since they're never changed
+ */
+static void push_unshare_config(push_t *push) {
+  GHashTable *config;
+  GHashTableIter iter;
+  const char *key;
+  push_val_t *val;
+
+  if (push_shares_config(push)) {
+    config = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+    g_hash_table_iter_init(&iter, push->config);
+    while (g_hash_table_iter_next(&iter, (void*)&key, (void*)&val)) {
+      g_hash_table_insert(config, g_strdup(key), val);
+    }
+
+    push->config = config;
+  }
+}
+
+
+/* Gives interpreter a new empty bindings table */
+static void push_bindings_new(push_t *push, push_int_t size) {
+  push->bindings = g_new0(push_binding_t, size);
+  push->bindings_size = size;
+  push->bindings_used = 0;
+}
+
+
+/* Frees bindings table, releasing the names of its slots */
+static void push_bindings_free(push_binding_t *bindings, push_int_t size) {
+  push_int_t i;
+
+  for (i = 0; i < size; i++) {
+    if (bindings[i].name != NULL) {
+      push_name_unref(bindings[i].name);
+    }
+  }
+  g_free(bindings);
+}
+
+
+/* Returns slot of name, or NULL
+ * NOTE: a name has at most one slot, but it may be invalid
+ */
+static push_binding_t *push_binding_find(push_t *push, push_name_t name) {
+  guint i, mask;
+
+  mask = push->bindings_size - 1;
+  for (i = push_binding_hash(push, name); push->bindings[i].name != NULL; i = (i + 1) & mask) {
+    if (push->bindings[i].name == name) {
+      return &push->bindings[i];
+    }
+  }
+
+  return NULL;
+}
+
+
+/* Returns first empty slot for name */
+static push_binding_t *push_binding_find_empty(push_t *push, push_name_t name) {
+  guint i, mask;
+
+  mask = push->bindings_size - 1;
+  for (i = push_binding_hash(push, name); push->bindings[i].name != NULL; i = (i + 1) & mask);
+
+  return &push->bindings[i];
+}
+
+
+/* Rebuilds bindings table with only the valid bindings
+ * NOTE: it's sized for the bound names, so it may also shrink
+ */
+static void push_bindings_rebuild(push_t *push) {
+  push_binding_t *old_bindings, *binding;
+  push_int_t i, old_size, size;
+
+  old_bindings = push->bindings;
+  old_size = push->bindings_size;
+
+  /* keep at most half of the slots used */
+  for (size = PUSH_BINDINGS_MIN_SIZE; size / 2 < push->bound->len + 1; size *= 2);
+  push_bindings_new(push, size);
+
+  for (i = 0; i < old_size; i++) {
+    binding = &old_bindings[i];
+    if (binding->name != NULL) {
+      if (push_binding_is_valid(push, binding)) {
+        *push_binding_find_empty(push, binding->name) = *binding;
+        push->bindings_used++;
+      }
+      else {
+        push_name_unref(binding->name);
+      }
+    }
+  }
+
+  g_free(old_bindings);
+}
+
+
+/* Makes bindings of interpreter its own, before they're changed
+ * NOTE: with copy == FALSE the interpreter gets empty bindings instead
+ */
+static void push_unshare_bindings(push_t *push, push_bool_t copy) {
+  push_binding_t *bindings;
+  GPtrArray *bound;
+  push_int_t i;
+
+  if (push_shares_bindings(push)) {
+    bindings = push->bindings;
+    bound = push->bound;
+
+    if (copy) {
+      push->bindings = g_new(push_binding_t, push->bindings_size);
+      memcpy(push->bindings, bindings, push->bindings_size * sizeof(push_binding_t));
+      for (i = 0; i < push->bindings_size; i++) {
+        if (push->bindings[i].name != NULL) {
+          push_name_ref(push->bindings[i].name);
+        }
+      }
+
+      push->bound = g_ptr_array_sized_new(bound->len);
+      for (i = 0; i < bound->len; i++) {
+        g_ptr_array_add(push->bound, g_ptr_array_index(bound, i));
+      }
+    }
+    else {
+      push_bindings_new(push, PUSH_BINDINGS_MIN_SIZE);
+      push->bound = g_ptr_array_new();
+    }
+  }
+}
+
+
 push_t *push_new_full(push_bool_t default_instructions, push_bool_t default_config, push_gc_t *gc, push_interrupt_handler_t interrupt_handler, push_step_hook_t step_hook) {
   push_t *push;
 
@@ -38,13 +193,20 @@ push_t *push_new_full(push_bool_t default_instructions, push_bool_t default_conf
   push->interrupt_handler = interrupt_handler;
   push->step_hook = step_hook;
   push->rand = g_rand_new();
-  push->names = g_string_chunk_new(PUSH_NAME_STORAGE_BLOCK_SIZE);
   push->gc = gc == NULL ? push_gc_global() : gc;
+  push->template = NULL;
+  push->interrupt_flag = 0;
 
   /* create hash tables */
   push->config = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
-  push->bindings = g_hash_table_new(NULL, NULL);
-  push->instructions = g_hash_table_new_full(NULL, NULL, NULL, (GDestroyNotify)push_instr_destroy);
+  push_bindings_new(push, PUSH_BINDINGS_MIN_SIZE);
+  push->bound = g_ptr_array_new();
+  push->generation = 0;
+  push->pool = NULL;
+
+  /* instruction set (subset is taken from config below) */
+  push->instructions = default_instructions ? push_dis_instrset() : push_instrset_new();
+  push->profile = NULL;
 
   /* initialize stacks */
   push->boolean = push_stack_new();
@@ -53,6 +215,9 @@ push_t *push_new_full(push_bool_t default_instructions, push_bool_t default_conf
   push->integer = push_stack_new();
   push->name = push_stack_new();
   push->real = push_stack_new();
+  push->intvec = push_stack_new();
+  push->realvec = push_stack_new();
+  push->string = push_stack_new();
 
   /* add interpreter to garbage collector */
   push_gc_add_interpreter(push->gc, push);
@@ -69,13 +234,6 @@ push_t *push_new_full(push_bool_t default_instructions, push_bool_t default_conf
     push_config_set(push, "NEW-ERC-NAME-PROBABILITY", push_val_new(push, PUSH_TYPE_REAL, 0.01));
   }
 
-  if (default_instructions) {
-    /* load default instruction set
-     * TODO: take from config, which instructions to load
-     */
-    push_add_dis(push);
-  }
-
   g_static_mutex_unlock(&push->mutex);
 
   return push;
@@ -101,19 +259,32 @@ void push_destroy(push_t *push) {
   push_stack_destroy(push->integer);
   push_stack_destroy(push->name);
   push_stack_destroy(push->real);
+  push_stack_destroy(push->intvec);
+  push_stack_destroy(push->realvec);
+  push_stack_destroy(push->string);
+
+  /* destroy hash tables, unless they're still shared with the template */
+  if (!push_shares_bindings(push)) {
+    push_bindings_free(push->bindings, push->bindings_size);
+    g_ptr_array_free(push->bound, TRUE);
+  }
+  if (!push_shares_config(push)) {
+    g_hash_table_destroy(push->config);
+  }
+  if (push->template != NULL) {
+    push_template_unref(push->template);
+  }
 
-  /* destroy hash tables */
-  g_hash_table_destroy(push->bindings);
-  g_hash_table_destroy(push->config);
-  g_hash_table_destroy(push->instructions);
+  /* release instruction set */
+  push_instrset_unref(push->instructions);
 
   /* destroy random number generator */
   g_rand_free(push->rand);
 
-  /* destroy storage for interned strings */
-  g_string_chunk_free(push->names);
-
-  /* destroy execution mutex */
+  /* destroy execution mutex
+   * NOTE: a locked mutex can't be freed
+   */
+  g_static_mutex_unlock(&push->mutex);
   g_static_mutex_free(&push->mutex);
 
   g_slice_free(push_t, push);
@@ -126,7 +297,8 @@ push_t *push_copy(push_t *push) {
   GHashTableIter iter;
   const char *key;
   push_val_t *val;
-  push_instr_t *instr;
+  push_int_t i;
+  push_name_t name;
 
   new_push = push_new_full(FALSE, FALSE, push->gc, push->interrupt_handler, push->step_hook);
 
@@ -137,16 +309,14 @@ push_t *push_copy(push_t *push) {
   }
 
   /* copy bindings */
-  g_hash_table_iter_init(&iter, push->bindings);
-  while (g_hash_table_iter_next(&iter, (void*)&key, (void*)&val)) {
-    push_define(new_push, push_intern_name(new_push, key), push_val_copy(val, new_push));
+  for (i = 0; i < push_num_bound(push); i++) {
+    name = push_nth_bound(push, i);
+    push_define(new_push, name, push_val_copy(push_lookup(push, name), new_push));
   }
 
-  /* copy instructions */
-  g_hash_table_iter_init(&iter, push->instructions);
-  while (g_hash_table_iter_next(&iter, (void*)&key, (void*)&instr)) {
-    push_instr_reg(new_push, key, instr->func, instr->userdata);
-  }
+  /* share instructions */
+  push_instrset_unref(new_push->instructions);
+  new_push->instructions = push_instrset_ref(push->instructions);
 
   /* copy stacks */
   new_push->boolean = push_stack_copy(push->boolean, new_push);
@@ -155,34 +325,224 @@ push_t *push_copy(push_t *push) {
   new_push->integer = push_stack_copy(push->integer, new_push);
   new_push->name = push_stack_copy(push->name, new_push);
   new_push->real = push_stack_copy(push->real, new_push);
+  new_push->intvec = push_stack_copy(push->intvec, new_push);
+  new_push->realvec = push_stack_copy(push->realvec, new_push);
+  new_push->string = push_stack_copy(push->string, new_push);
 
   return new_push;
 }
 
 
-void push_flush(push_t *push) {
-  /* flush all stacks */
+/* Returns template with configuration, bindings and instructions of interpreter
+ * NOTE: the stacks aren't part of the template
+ */
+push_template_t *push_template_new(push_t *push) {
+  push_template_t *template;
+  push_t *template_push;
+  GHashTableIter iter;
+  const char *key;
+  push_val_t *val;
+  push_int_t i;
+  push_name_t name;
+
+  g_return_val_if_null(push, NULL);
+
+  template_push = push_new_full(FALSE, FALSE, push->gc, push->interrupt_handler, push->step_hook);
+
+  g_static_mutex_lock(&push->mutex);
+
+  g_hash_table_iter_init(&iter, push->config);
+  while (g_hash_table_iter_next(&iter, (void*)&key, (void*)&val)) {
+    push_config_set(template_push, key, push_val_copy(val, template_push));
+  }
+
+  for (i = 0; i < push_num_bound(push); i++) {
+    name = push_nth_bound(push, i);
+    push_define(template_push, name, push_val_copy(push_lookup(push, name), template_push));
+  }
+
+  push_instrset_unref(template_push->instructions);
+  template_push->instructions = push_instrset_ref(push->instructions);
+
+  g_static_mutex_unlock(&push->mutex);
+
+  template = g_slice_new(push_template_t);
+  template->ref_count = 1;
+  template->push = template_push;
+
+  return template;
+}
+
+
+push_template_t *push_template_ref(push_template_t *template) {
+  g_return_val_if_null(template, NULL);
+
+  g_atomic_int_inc(&template->ref_count);
+
+  return template;
+}
+
+
+void push_template_unref(push_template_t *template) {
+  g_return_if_null(template);
+
+  if (g_atomic_int_dec_and_test(&template->ref_count)) {
+    push_destroy(template->push);
+    g_slice_free(push_template_t, template);
+  }
+}
+
+
+/* Returns new interpreter with empty stacks, that shares configuration,
+ * bindings and instructions with the template
+ * NOTE: Unlike push_copy, this is thread-safe and doesn't copy anything.
+ */
+push_t *push_new_from_template(push_template_t *template) {
+  push_t *push;
+
+  g_return_val_if_null(template, NULL);
+
+  push = g_slice_new(push_t);
+
+  g_static_mutex_init(&push->mutex);
+
+  push->interrupt_handler = template->push->interrupt_handler;
+  push->step_hook = template->push->step_hook;
+  push->interrupt_flag = 0;
+  push->userdata = NULL;
+  push->profile = NULL;
+  push->gc = template->push->gc;
+  push->template = push_template_ref(template);
+
+  /* NOTE: g_rand_new() would read a seed from /dev/urandom */
+  push->rand = g_rand_new_with_seed(g_random_int());
+
+  /* share everything else */
+  push->config = template->push->config;
+  push->bindings = template->push->bindings;
+  push->bindings_size = template->push->bindings_size;
+  push->bindings_used = template->push->bindings_used;
+  push->bound = template->push->bound;
+  push->generation = template->push->generation;
+  push->pool = NULL;
+  push->instructions = push_instrset_ref(template->push->instructions);
+
+  push->boolean = push_stack_new();
+  push->code = push_stack_new();
+  push->exec = push_stack_new();
+  push->integer = push_stack_new();
+  push->name = push_stack_new();
+  push->real = push_stack_new();
+  push->intvec = push_stack_new();
+  push->realvec = push_stack_new();
+  push->string = push_stack_new();
+
+  push_gc_add_interpreter(push->gc, push);
+
+  return push;
+}
+
+
+static void push_flush_stacks(push_t *push) {
   push_stack_flush(push->boolean);
   push_stack_flush(push->code);
   push_stack_flush(push->exec);
   push_stack_flush(push->integer);
   push_stack_flush(push->name);
   push_stack_flush(push->real);
+  push_stack_flush(push->intvec);
+  push_stack_flush(push->realvec);
+  push_stack_flush(push->string);
+}
+
 
-  /* remove all bindings */
-  g_hash_table_remove_all(push->bindings);
+void push_flush(push_t *push) {
+  /* flush all stacks */
+  push_flush_stacks(push);
+
+  /* remove all bindings
+   * NOTE: by starting a new generation, so this doesn't depend on their number
+   */
+  if (push_shares_bindings(push)) {
+    push_unshare_bindings(push, FALSE);
+  }
+  else if (push->bound->len > 0) {
+    if (push->generation == G_MAXINT) {
+      push_bindings_free(push->bindings, push->bindings_size);
+      push_bindings_new(push, PUSH_BINDINGS_MIN_SIZE);
+      push->generation = 0;
+    }
+    else {
+      push->generation++;
+    }
+    g_ptr_array_set_size(push->bound, 0);
+  }
 }
 
 
-push_name_t push_intern_name(push_t *push, const char *name) {
-  g_return_val_if_null(push, NULL);
+/* Resets interpreter to the state of its template, or flushes it
+ * NOTE: Changes to configuration, bindings or instructions are dropped, and
+ *       the interpreter shares them with the template again.
+ */
+void push_reset(push_t *push) {
+  push_template_t *template;
+
+  g_return_if_null(push);
+
+  template = push->template;
+  if (template == NULL) {
+    push_flush(push);
+  }
+  else {
+    push_flush_stacks(push);
+
+    if (!push_shares_bindings(push)) {
+      push_bindings_free(push->bindings, push->bindings_size);
+      g_ptr_array_free(push->bound, TRUE);
+      push->bindings = template->push->bindings;
+      push->bindings_size = template->push->bindings_size;
+      push->bindings_used = template->push->bindings_used;
+      push->bound = template->push->bound;
+      push->generation = template->push->generation;
+    }
+
+    if (!push_shares_config(push)) {
+      g_hash_table_destroy(push->config);
+      push->config = template->push->config;
+    }
+
+    if (push->instructions != template->push->instructions) {
+      push_instrset_unref(push->instructions);
+      push->instructions = push_instrset_ref(template->push->instructions);
+    }
+
+    push->interrupt_handler = template->push->interrupt_handler;
+    push->step_hook = template->push->step_hook;
+  }
+
+  push->interrupt_flag = 0;
+  push->userdata = NULL;
+}
 
-  return g_string_chunk_insert_const(push->names, name);
+
+/* Returns interned name
+ * NOTE: names are shared by all interpreters (see push_name_intern)
+ */
+push_name_t push_intern_name(push_t *push, const char *name) {
+  return push_name_intern(name);
 }
 
 
+/* NOTE: setting INSTRUCTIONS or INSTRUCTION-WEIGHTS changes the instruction
+ *       set right away (see push_instr_load_config)
+ */
 void push_config_set(push_t *push, const char *key, push_val_t *val) {
+  push_unshare_config(push);
   g_hash_table_insert(push->config, g_strdup(key), val);
+
+  if (strcmp(key, "INSTRUCTIONS") == 0 || strcmp(key, "INSTRUCTION-WEIGHTS") == 0) {
+    push_instr_load_config(push);
+  }
 }
 
 
@@ -192,28 +552,107 @@ push_val_t *push_config_get(push_t *push, const char *key) {
 
 
 void push_define(push_t *push, push_name_t name, push_val_t *val) {
+  push_binding_t *binding, *unused;
+  guint i, mask;
+
   g_return_if_null(push);
+  g_return_if_null(name);
 
   if (!push_check_name(val) && !push_check_name(val)) {
-    g_hash_table_insert(push->bindings, name, val);
+    push_unshare_bindings(push, TRUE);
+
+    /* look for the slot of name, and remember the first invalid slot */
+    binding = NULL;
+    unused = NULL;
+    mask = push->bindings_size - 1;
+    for (i = push_binding_hash(push, name); push->bindings[i].name != NULL; i = (i + 1) & mask) {
+      if (push->bindings[i].name == name) {
+        binding = &push->bindings[i];
+        break;
+      }
+      else if (unused == NULL && !push_binding_is_valid(push, &push->bindings[i])) {
+        unused = &push->bindings[i];
+      }
+    }
+
+    if (binding == NULL) {
+      if (unused != NULL) {
+        /* reuse invalid slot */
+        binding = unused;
+        push_name_unref(binding->name);
+      }
+      else {
+        /* NOTE: slots stay used until the table is rebuilt, so at least one
+         *       of them is always empty
+         */
+        if ((push->bindings_used + 1) * 4 > push->bindings_size * 3) {
+          push_bindings_rebuild(push);
+        }
+        binding = push_binding_find_empty(push, name);
+        push->bindings_used++;
+      }
+
+      binding->name = push_name_ref(name);
+      binding->val = NULL;
+    }
+
+    if (!push_binding_is_valid(push, binding)) {
+      binding->pos = push->bound->len;
+      binding->generation = push->generation;
+      g_ptr_array_add(push->bound, name);
+    }
+    binding->val = val;
   }
 }
 
 
 void push_undef(push_t *push, push_name_t name) {
-  push_val_t *val;
+  push_binding_t *binding;
 
   g_return_if_null(push);
+  g_return_if_null(name);
 
-  val = g_hash_table_lookup(push->bindings, name);
-  if (val != NULL) {
-    g_hash_table_remove(push->bindings, name);
+  if (push_lookup(push, name) != NULL) {
+    push_unshare_bindings(push, TRUE);
+
+    /* the last bound name takes its position
+     * NOTE: the slot keeps the name until it's reused
+     */
+    binding = push_binding_find(push, name);
+    g_ptr_array_remove_index_fast(push->bound, binding->pos);
+    if (binding->pos < push->bound->len) {
+      push_binding_find(push, g_ptr_array_index(push->bound, binding->pos))->pos = binding->pos;
+    }
+    binding->val = NULL;
   }
 }
 
 
 push_val_t *push_lookup(push_t *push, push_name_t name) {
-  g_hash_table_lookup(push->bindings, name);
+  push_binding_t *binding;
+
+  binding = push_binding_find(push, name);
+  return binding != NULL && push_binding_is_valid(push, binding) ? binding->val : NULL;
+}
+
+
+/* Returns number of bound names */
+push_int_t push_num_bound(push_t *push) {
+  g_return_val_if_null(push, 0);
+
+  return push->bound->len;
+}
+
+
+/* Returns n-th bound name (in no particular order), or NULL */
+push_name_t push_nth_bound(push_t *push, push_int_t n) {
+  g_return_val_if_null(push, NULL);
+
+  if (n < 0 || n >= push->bound->len) {
+    return NULL;
+  }
+
+  return (push_name_t)g_ptr_array_index(push->bound, n);
 }
 
 
@@ -230,8 +669,10 @@ void push_do_val(push_t *push, push_val_t *val) {
     case PUSH_TYPE_CODE:
       g_return_if_null(val);
 
-      /* push all values of code object onto exec stack in reverse order */
-      push_code_push_elements(val->code, push->exec);
+      /* push all values of code object onto exec stack in reverse order
+       * NOTE: done lazily by a cursor, so this doesn't copy the code
+       */
+      push_stack_push_code(push->exec, val);
       break;
 
     case PUSH_TYPE_INT:
@@ -241,7 +682,7 @@ void push_do_val(push_t *push, push_val_t *val) {
     case PUSH_TYPE_INSTR:
       g_return_if_null(val);
 
-      push_call_instr(push, val->instr);
+      push_instr_call(push, val->instr);
       break;
 
     case PUSH_TYPE_NAME:
@@ -260,6 +701,18 @@ void push_do_val(push_t *push, push_val_t *val) {
       push_stack_push(push->real, val);
       break;
 
+    case PUSH_TYPE_INTVEC:
+      push_stack_push(push->intvec, val);
+      break;
+
+    case PUSH_TYPE_REALVEC:
+      push_stack_push(push->realvec, val);
+      break;
+
+    case PUSH_TYPE_STRING:
+      push_stack_push(push->string, val);
+      break;
+
     default:
       g_warning("Unknown value type: %d", val->type);
       break;
@@ -277,6 +730,9 @@ push_bool_t push_step(push_t *push) {
 
   val = push_stack_pop(push->exec);
   if (val != NULL) {
+    if (push->profile != NULL) {
+      push_profile_step(push->profile, val);
+    }
     push_do_val(push, val);
   }
 
@@ -300,15 +756,26 @@ push_bool_t push_step(push_t *push) {
 
 
 push_int_t push_run(push_t *push, push_int_t max_steps) {
+  g_return_val_if_null(push, 0);
+
+  /* clear interrupt flag */
+  push->interrupt_flag = 0;
+
+  return push_resume(push, max_steps);
+}
+
+
+/* Continue running an interpreter
+ * NOTE: Unlike push_run, this doesn't clear the interrupt flag, so that an
+ *       interrupt raised between two runs isn't lost.
+ */
+push_int_t push_resume(push_t *push, push_int_t max_steps) {
   push_int_t i;
 
-  g_return_if_null(push);
+  g_return_val_if_null(push, 0);
 
   g_static_mutex_lock(&push->mutex);
 
-  /* clear interrupt flag */
-  push->interrupt_flag = 0;
-
   /* run until max_steps reached, EXEC stack is empty or an interrupt was raised */
   if (max_steps > 0) {
     for (i = 0; i < max_steps && push_step(push); i++);
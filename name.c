@@ -0,0 +1,188 @@
+/* name.c - Interned names
+ * NOTE: All interpreters share one table of names, so a name has the same
+ *       pointer and id everywhere and values can be moved between
+ *       interpreters as they are. Interned names are never freed, so
+ *       generated names (push_name_new) aren't interned, but reference
+ *       counted instead.
+ *
+ * Copyright (c) 2012 Janosch Gräf <janosch.graef@gmx.net>
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "push.h"
+
+
+
+/* Lock for the name table
+ * NOTE: names are looked up far more often than added
+ */
+static GStaticRWLock push_names_lock = G_STATIC_RW_LOCK_INIT;
+
+/* string -> push_name_t */
+static GHashTable *push_names_table = NULL;
+
+/* id -> push_name_t */
+static GPtrArray *push_names = NULL;
+
+/* number of generated names so far (their ids count down from -1) */
+static gint push_names_generated = 0;
+
+
+/* Header stored right before the characters of a name */
+typedef struct {
+  /* reference counter, or -1 if interned */
+  volatile gint ref_count;
+
+  /* id (see push_name_id) */
+  push_int_t id;
+} push_name_header_t;
+
+
+/* Returns new name block with header and characters */
+static push_name_t push_name_alloc(const char *name, gint ref_count, push_int_t id) {
+  push_name_header_t *header;
+  gsize length;
+
+  length = strlen(name);
+  header = g_malloc(sizeof(push_name_header_t) + length + 1);
+  header->ref_count = ref_count;
+  header->id = id;
+  memcpy(header + 1, name, length + 1);
+
+  return (push_name_t)(header + 1);
+}
+
+
+static void push_names_init(void) {
+  static gsize initialized = 0;
+
+  if (g_once_init_enter(&initialized)) {
+    push_names_table = g_hash_table_new(g_str_hash, g_str_equal);
+    push_names = g_ptr_array_new();
+    g_once_init_leave(&initialized, 1);
+  }
+}
+
+
+/* Returns interned name, which has a dense id (see push_name_id)
+ * NOTE: equal names are interned only once, so they can be compared by
+ *       pointer
+ */
+push_name_t push_name_intern(const char *name) {
+  push_name_t interned;
+
+  g_return_val_if_null(name, NULL);
+
+  push_names_init();
+
+  g_static_rw_lock_reader_lock(&push_names_lock);
+  interned = (push_name_t)g_hash_table_lookup(push_names_table, name);
+  g_static_rw_lock_reader_unlock(&push_names_lock);
+
+  if (interned == NULL) {
+    g_static_rw_lock_writer_lock(&push_names_lock);
+
+    /* NOTE: another thread may have added it in the meantime */
+    interned = (push_name_t)g_hash_table_lookup(push_names_table, name);
+    if (interned == NULL) {
+      interned = push_name_alloc(name, -1, push_names->len);
+      g_ptr_array_add(push_names, interned);
+      g_hash_table_insert(push_names_table, interned, interned);
+    }
+
+    g_static_rw_lock_writer_unlock(&push_names_lock);
+  }
+
+  return interned;
+}
+
+
+/* Returns interned name with id, or NULL */
+push_name_t push_name_get(push_int_t id) {
+  push_name_t name = NULL;
+
+  push_names_init();
+
+  g_static_rw_lock_reader_lock(&push_names_lock);
+  if (id >= 0 && id < push_names->len) {
+    name = (push_name_t)g_ptr_array_index(push_names, id);
+  }
+  g_static_rw_lock_reader_unlock(&push_names_lock);
+
+  return name;
+}
+
+
+/* Returns number of interned names (ids are below it) */
+push_int_t push_name_count(void) {
+  push_int_t count;
+
+  push_names_init();
+
+  g_static_rw_lock_reader_lock(&push_names_lock);
+  count = push_names->len;
+  g_static_rw_lock_reader_unlock(&push_names_lock);
+
+  return count;
+}
+
+
+/* Returns new name, that is not interned and not equal to any other name
+ * NOTE: The name isn't referenced yet, so it must be stored in a value or
+ *       bound right away (which references it), or freed with
+ *       push_name_ref and push_name_unref. It has a negative id.
+ */
+push_name_t push_name_new(const char *name) {
+  g_return_val_if_null(name, NULL);
+
+  /* NOTE: ids may repeat after wrapping around, but stay negative */
+  return push_name_alloc(name, 0, -1 - (g_atomic_int_exchange_and_add(&push_names_generated, 1) & G_MAXINT));
+}
+
+
+/* NOTE: does nothing for interned names */
+push_name_t push_name_ref(push_name_t name) {
+  push_name_header_t *header;
+
+  g_return_val_if_null(name, NULL);
+
+  header = ((push_name_header_t*)name) - 1;
+  if (header->ref_count >= 0) {
+    g_atomic_int_inc(&header->ref_count);
+  }
+
+  return name;
+}
+
+
+/* NOTE: does nothing for interned names */
+void push_name_unref(push_name_t name) {
+  push_name_header_t *header;
+
+  g_return_if_null(name);
+
+  header = ((push_name_header_t*)name) - 1;
+  if (header->ref_count >= 0 && g_atomic_int_dec_and_test(&header->ref_count)) {
+    g_free(header);
+  }
+}
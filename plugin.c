@@ -0,0 +1,132 @@
+/* plugin.c - Native instruction plugins
+ * NOTE: Plugins are shared objects, that export a push_plugin_t (see
+ *       PUSH_PLUGIN) and register their instructions when loaded.
+ *
+ * Copyright (c) 2012 Janosch Gräf <janosch.graef@gmx.net>
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <glib.h>
+
+#include "push.h"
+
+
+
+/* Load plugin from shared object and register its instructions with the
+ * interpreter. Returns if this succeeded.
+ * NOTE: Plugins are never unloaded, since other interpreters may share their
+ *       instructions (see push_instr_unshare).
+ */
+push_bool_t push_plugin_load(push_t *push, const char *filename, void *userdata) {
+  GModule *module;
+  const push_plugin_t *plugin;
+
+  g_return_val_if_null(push, FALSE);
+  g_return_val_if_null(filename, FALSE);
+
+  if (!g_module_supported()) {
+    g_warning("Plugins are not supported on this platform");
+    return FALSE;
+  }
+
+  module = g_module_open(filename, G_MODULE_BIND_LAZY | G_MODULE_BIND_LOCAL);
+  if (module == NULL) {
+    g_warning("Can't load plugin %s: %s", filename, g_module_error());
+    return FALSE;
+  }
+
+  if (!g_module_symbol(module, PUSH_PLUGIN_SYMBOL, (gpointer*)&plugin) || plugin == NULL) {
+    g_warning("%s is not a plugin: %s", filename, g_module_error());
+    g_module_close(module);
+    return FALSE;
+  }
+
+  if (plugin->abi_version != PUSH_PLUGIN_ABI_VERSION) {
+    g_warning("Plugin %s was built for ABI version %d (expected %d)", filename, plugin->abi_version, PUSH_PLUGIN_ABI_VERSION);
+    g_module_close(module);
+    return FALSE;
+  }
+
+  g_module_make_resident(module);
+
+  if (plugin->init == NULL || !plugin->init(push_instr_unshare(push), userdata)) {
+    g_warning("Plugin %s (%s) failed to initialize", plugin->name, filename);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+
+void push_plugin_push_bools(push_t *push, const push_bool_t *bools, push_int_t n) {
+  g_return_if_null(push);
+
+  push_stack_push_array(push, push->boolean, PUSH_TYPE_BOOL, bools, n);
+}
+
+
+void push_plugin_push_ints(push_t *push, const push_int_t *ints, push_int_t n) {
+  g_return_if_null(push);
+
+  push_stack_push_array(push, push->integer, PUSH_TYPE_INT, ints, n);
+}
+
+
+void push_plugin_push_reals(push_t *push, const push_real_t *reals, push_int_t n) {
+  g_return_if_null(push);
+
+  push_stack_push_array(push, push->real, PUSH_TYPE_REAL, reals, n);
+}
+
+
+/* pop n values of type into data (top one into the last element)
+ * NOTE: pops nothing and returns FALSE, if there are less than n values
+ */
+static push_bool_t push_plugin_pop(push_stack_t *stack, int type, void *data, push_int_t n) {
+  if (push_stack_read_array(stack, type, data, n) < n) {
+    return FALSE;
+  }
+
+  while (n-- > 0) {
+    push_stack_pop(stack);
+  }
+
+  return TRUE;
+}
+
+
+push_bool_t push_plugin_pop_bools(push_t *push, push_bool_t *bools, push_int_t n) {
+  g_return_val_if_null(push, FALSE);
+
+  return push_plugin_pop(push->boolean, PUSH_TYPE_BOOL, bools, n);
+}
+
+
+push_bool_t push_plugin_pop_ints(push_t *push, push_int_t *ints, push_int_t n) {
+  g_return_val_if_null(push, FALSE);
+
+  return push_plugin_pop(push->integer, PUSH_TYPE_INT, ints, n);
+}
+
+
+push_bool_t push_plugin_pop_reals(push_t *push, push_real_t *reals, push_int_t n) {
+  g_return_val_if_null(push, FALSE);
+
+  return push_plugin_pop(push->real, PUSH_TYPE_REAL, reals, n);
+}
@@ -0,0 +1,136 @@
+/* pool.c - Pools of interpreters
+ *
+ * Copyright (c) 2012 Janosch Gräf <janosch.graef@gmx.net>
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <glib.h>
+
+#include "push.h"
+
+
+
+push_pool_t *push_pool_new(push_template_t *template, push_int_t max_free) {
+  push_pool_t *pool;
+
+  g_return_val_if_null(template, NULL);
+
+  pool = g_slice_new(push_pool_t);
+  pool->template = push_template_ref(template);
+  pool->free = g_ptr_array_new();
+  pool->max_free = max_free;
+  pool->mutex = g_mutex_new();
+
+  return pool;
+}
+
+
+/* Destroys pool and the interpreters in it
+ * NOTE: interpreters that were taken and not put back must be destroyed by
+ *       the caller
+ */
+void push_pool_destroy(push_pool_t *pool) {
+  push_int_t i;
+
+  g_return_if_null(pool);
+
+  for (i = 0; i < pool->free->len; i++) {
+    push_destroy((push_t*)g_ptr_array_index(pool->free, i));
+  }
+  g_ptr_array_free(pool->free, TRUE);
+
+  push_template_unref(pool->template);
+  g_mutex_free(pool->mutex);
+
+  g_slice_free(push_pool_t, pool);
+}
+
+
+/* Returns interpreter in the state of the template */
+push_t *push_pool_get(push_pool_t *pool) {
+  push_t *push = NULL;
+
+  g_return_val_if_null(pool, NULL);
+
+  g_mutex_lock(pool->mutex);
+  if (pool->free->len > 0) {
+    push = (push_t*)g_ptr_array_remove_index_fast(pool->free, pool->free->len - 1);
+  }
+  g_mutex_unlock(pool->mutex);
+
+  if (push == NULL) {
+    push = push_new_from_template(pool->template);
+  }
+  push->pool = pool;
+
+  return push;
+}
+
+
+/* Creates interpreters until the pool has num of them ready (or is full)
+ * NOTE: the interpreters are allocated by the calling thread
+ */
+void push_pool_fill(push_pool_t *pool, push_int_t num) {
+  push_t *push;
+  push_int_t missing;
+
+  g_return_if_null(pool);
+
+  if (pool->max_free > 0) {
+    num = MIN(num, pool->max_free);
+  }
+
+  g_mutex_lock(pool->mutex);
+  missing = num - pool->free->len;
+  g_mutex_unlock(pool->mutex);
+
+  for (; missing > 0; missing--) {
+    push = push_new_from_template(pool->template);
+
+    g_mutex_lock(pool->mutex);
+    g_ptr_array_add(pool->free, push);
+    g_mutex_unlock(pool->mutex);
+  }
+}
+
+
+/* Puts interpreter back into its pool */
+void push_pool_put(push_pool_t *pool, push_t *push) {
+  g_return_if_null(pool);
+  g_return_if_null(push);
+  g_return_if_fail(push->pool == pool);
+
+  push->pool = NULL;
+
+  /* NOTE: the execution mutex is held while the interpreter runs */
+  g_static_mutex_lock(&push->mutex);
+  push_reset(push);
+  g_static_mutex_unlock(&push->mutex);
+
+  g_mutex_lock(pool->mutex);
+  if (pool->max_free <= 0 || pool->free->len < pool->max_free) {
+    g_ptr_array_add(pool->free, push);
+    push = NULL;
+  }
+  g_mutex_unlock(pool->mutex);
+
+  if (push != NULL) {
+    push_destroy(push);
+  }
+}
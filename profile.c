@@ -0,0 +1,317 @@
+/* profile.c - Instruction profiles & superinstructions
+ * NOTE: A profile counts how often instructions and sequences of fusable
+ *       instructions are executed. The most frequent sequences become
+ *       superinstructions, which push_prepare puts into programs.
+ *
+ * Copyright (c) 2012 Janosch Gräf <janosch.graef@gmx.net>
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <glib.h>
+
+#include "push.h"
+
+
+
+static guint push_profile_seq_hash(const push_profile_seq_t *seq) {
+  guint h = 0;
+  push_int_t i;
+
+  for (i = 0; i < seq->length; i++) {
+    h = h * 31 + g_direct_hash(seq->instrs[i]);
+  }
+
+  return h;
+}
+
+
+static gboolean push_profile_seq_equal(const push_profile_seq_t *seq1, const push_profile_seq_t *seq2) {
+  push_int_t i;
+
+  if (seq1->length != seq2->length) {
+    return FALSE;
+  }
+
+  for (i = 0; i < seq1->length; i++) {
+    if (seq1->instrs[i] != seq2->instrs[i]) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+
+static void push_profile_seq_destroy(push_profile_seq_t *seq) {
+  g_slice_free(push_profile_seq_t, seq);
+}
+
+
+push_profile_t *push_profile_new(void) {
+  push_profile_t *profile;
+  push_int_t i;
+
+  profile = g_slice_new(push_profile_t);
+  profile->seqs = g_hash_table_new_full((GHashFunc)push_profile_seq_hash, (GEqualFunc)push_profile_seq_equal, (GDestroyNotify)push_profile_seq_destroy, NULL);
+
+  for (i = 0; i < PUSH_PROFILE_MAX_SEQ - 1; i++) {
+    profile->last[i] = NULL;
+  }
+
+  return profile;
+}
+
+
+void push_profile_destroy(push_profile_t *profile) {
+  g_return_if_null(profile);
+
+  g_hash_table_destroy(profile->seqs);
+  g_slice_free(push_profile_t, profile);
+}
+
+
+/* count sequence of n instructions (oldest first) */
+static void push_profile_add(push_profile_t *profile, push_instr_t **instrs, push_int_t n) {
+  push_profile_seq_t key, *seq;
+  push_int_t i;
+
+  key.length = n;
+  for (i = 0; i < n; i++) {
+    key.instrs[i] = instrs[i];
+  }
+
+  seq = (push_profile_seq_t*)g_hash_table_lookup(profile->seqs, &key);
+  if (seq == NULL) {
+    seq = g_slice_dup(push_profile_seq_t, &key);
+    seq->count = 0;
+    g_hash_table_insert(profile->seqs, seq, seq);
+  }
+
+  seq->count++;
+}
+
+
+/* Record execution of a value
+ * NOTE: called by push_step for each value, if the interpreter has a profile
+ */
+void push_profile_step(push_profile_t *profile, push_val_t *val) {
+  push_instr_t *instrs[PUSH_PROFILE_MAX_SEQ];
+  push_int_t i, n;
+
+  g_return_if_null(profile);
+  g_return_if_null(val);
+
+  if (!push_check_instr(val)) {
+    /* other values break sequences */
+    for (i = 0; i < PUSH_PROFILE_MAX_SEQ - 1; i++) {
+      profile->last[i] = NULL;
+    }
+    return;
+  }
+
+  /* count instruction itself */
+  push_profile_add(profile, &val->instr, 1);
+
+  if (!(val->instr->flags & PUSH_INSTR_FUSABLE)) {
+    for (i = 0; i < PUSH_PROFILE_MAX_SEQ - 1; i++) {
+      profile->last[i] = NULL;
+    }
+    return;
+  }
+
+  /* count sequences ending with it */
+  instrs[PUSH_PROFILE_MAX_SEQ - 1] = val->instr;
+  for (n = 1; n < PUSH_PROFILE_MAX_SEQ && profile->last[n - 1] != NULL; n++) {
+    instrs[PUSH_PROFILE_MAX_SEQ - 1 - n] = profile->last[n - 1];
+    push_profile_add(profile, instrs + PUSH_PROFILE_MAX_SEQ - 1 - n, n + 1);
+  }
+
+  /* shift history */
+  for (i = PUSH_PROFILE_MAX_SEQ - 2; i > 0; i--) {
+    profile->last[i] = profile->last[i - 1];
+  }
+  profile->last[0] = val->instr;
+}
+
+
+/* Returns how often the sequence of n instructions was executed */
+guint64 push_profile_count(push_profile_t *profile, push_instr_t **instrs, push_int_t n) {
+  push_profile_seq_t key, *seq;
+  push_int_t i;
+
+  g_return_val_if_null(profile, 0);
+  g_return_val_if_fail(n > 0 && n <= PUSH_PROFILE_MAX_SEQ, 0);
+
+  key.length = n;
+  for (i = 0; i < n; i++) {
+    key.instrs[i] = instrs[i];
+  }
+
+  seq = (push_profile_seq_t*)g_hash_table_lookup(profile->seqs, &key);
+
+  return seq != NULL ? seq->count : 0;
+}
+
+
+/* sort sequences by the number of dispatches they would save */
+static gint push_profile_seq_cmp(const push_profile_seq_t **seq1, const push_profile_seq_t **seq2) {
+  guint64 saved1, saved2;
+
+  saved1 = (*seq1)->count * ((*seq1)->length - 1);
+  saved2 = (*seq2)->count * ((*seq2)->length - 1);
+
+  return saved1 < saved2 ? 1 : (saved1 > saved2 ? -1 : 0);
+}
+
+
+/* Returns copy of instruction set with superinstructions for the (at most
+ * max_super) most frequent sequences, that were executed at least min_count
+ * times
+ * NOTE: Only sequences of instructions from instrs are used
+ */
+push_instrset_t *push_profile_fuse(push_profile_t *profile, push_instrset_t *instrs, push_int_t max_super, guint64 min_count) {
+  push_instrset_t *new_instrs;
+  push_profile_seq_t *seq;
+  GHashTableIter iter;
+  GPtrArray *candidates;
+  push_int_t i, j, n;
+
+  g_return_val_if_null(profile, NULL);
+  g_return_val_if_null(instrs, NULL);
+
+  /* collect sequences */
+  candidates = g_ptr_array_new();
+  g_hash_table_iter_init(&iter, profile->seqs);
+  while (g_hash_table_iter_next(&iter, (void*)&seq, NULL)) {
+    if (seq->length > 1 && seq->count >= min_count) {
+      for (j = 0; j < seq->length && push_instrset_lookup(instrs, seq->instrs[j]->name) == seq->instrs[j]; j++);
+      if (j == seq->length) {
+        g_ptr_array_add(candidates, seq);
+      }
+    }
+  }
+
+  g_ptr_array_sort(candidates, (GCompareFunc)push_profile_seq_cmp);
+
+  /* register superinstructions */
+  new_instrs = push_instrset_copy(instrs);
+  n = MIN(max_super, (push_int_t)candidates->len);
+  for (i = 0; i < n; i++) {
+    seq = (push_profile_seq_t*)g_ptr_array_index(candidates, i);
+    push_instrset_reg_super(new_instrs, seq->instrs, seq->length);
+  }
+
+  g_ptr_array_free(candidates, TRUE);
+
+  return new_instrs;
+}
+
+
+/* check if values of code can't tell superinstructions from their parts
+ * NOTE: instructions that use the EXEC stack see how many values are left
+ *       there, and names may be bound to such instructions
+ */
+static push_bool_t push_prepare_check(push_val_t *val) {
+  push_code_walk_t walk;
+  push_val_t *val2;
+  push_bool_t ok = TRUE;
+
+  if (!push_check_code(val)) {
+    return FALSE;
+  }
+
+  push_code_walk_init(&walk, val->code);
+  while (ok && (val2 = push_code_walk_next(&walk)) != NULL) {
+    if (push_check_name(val2) || (push_check_instr(val2) && !(val2->instr->flags & PUSH_INSTR_FUSABLE))) {
+      ok = FALSE;
+    }
+  }
+  push_code_walk_clear(&walk);
+
+  return ok;
+}
+
+
+/* replace runs of instructions in code by superinstructions (longest first) */
+static void push_prepare_code(push_t *push, push_code_t *code, GString *name) {
+  GList *link, *link2;
+  push_instr_t *instr;
+  push_int_t i, n;
+
+  for (link = code->head; link != NULL; link = link->next) {
+    for (n = PUSH_PROFILE_MAX_SEQ; n > 1; n--) {
+      /* name of the next n instructions */
+      g_string_truncate(name, 0);
+      for (i = 0, link2 = link; i < n && link2 != NULL && push_check_instr((push_val_t*)link2->data); i++, link2 = link2->next) {
+        g_string_append_printf(name, i == 0 ? "%s" : " %s", ((push_val_t*)link2->data)->instr->name);
+      }
+      if (i < n) {
+        continue;
+      }
+
+      instr = push_instr_lookup(push, name->str);
+      if (instr != NULL && instr->parts != NULL) {
+        link->data = push_val_new(push, PUSH_TYPE_INSTR, instr);
+        for (i = 1; i < n; i++) {
+          g_queue_delete_link(code, link->next);
+        }
+        break;
+      }
+    }
+  }
+}
+
+
+/* Returns program with the superinstructions of the interpreter's set
+ * NOTE: A superinstruction runs its parts in a single step, with the same
+ *       result. Programs that could notice (e.g. by using the EXEC stack) are
+ *       returned as they are, all others are copied.
+ */
+push_val_t *push_prepare(push_t *push, push_val_t *val) {
+  push_val_t *new_val, *val2;
+  push_code_walk_t walk;
+  GString *name;
+
+  g_return_val_if_null(push, NULL);
+  g_return_val_if_null(val, NULL);
+
+  if (!push_prepare_check(val)) {
+    return val;
+  }
+
+  new_val = push_val_copy(val, push);
+  name = g_string_new(NULL);
+
+  /* fuse in all code values of the copy */
+  push_prepare_code(push, new_val->code, name);
+
+  push_code_walk_init(&walk, new_val->code);
+  while ((val2 = push_code_walk_next(&walk)) != NULL) {
+    if (push_check_code(val2)) {
+      /* NOTE: the walk descends into the code after this */
+      push_prepare_code(push, val2->code, name);
+    }
+  }
+  push_code_walk_clear(&walk);
+
+  g_string_free(name, TRUE);
+
+  return new_val;
+}
+
@@ -53,6 +53,9 @@ class push_t(Structure):
                 ("int", push_stack_P),
                 ("name", push_stack_P),
                 ("real", push_stack_P),
+                ("intvec", push_stack_P),
+                ("realvec", push_stack_P),
+                ("string", push_stack_P),
                 ("interrupt", push_int_t)]
 push_P = POINTER(push_t)
 
@@ -60,6 +63,7 @@ push_P = POINTER(push_t)
 push_instr_func_t = CFUNCTYPE(c_void, push_P, c_void_p)
 class push_instr_t(Structure):
     _fields_ = [("name", push_name_t),
+                ("opcode", push_int_t),
                 ("func", push_instr_func_t),
                 ("userdata", c_void_p)]
 push_instr_P = POINTER(push_instr_t)
@@ -81,7 +85,9 @@ class push_val_t_union(Union):
                 ("int", push_int_t),
                 ("instr", push_instr_P),
                 ("name", push_name_t),
-                ("real", push_real_t)]
+                ("real", push_real_t),
+                ("vec", c_void_p),
+                ("str", c_void_p)]
 class push_val_t(Structure):
     _fields_ = [("type", c_int),
                 ("v", push_val_t_union)]
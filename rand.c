@@ -26,20 +26,6 @@
 
 
 
-static void g_hash_table_random(GRand *rand, GHashTable *hash_table, void *key, void *value) {
-  int i, j, size;
-  GHashTableIter iter;
-
-  size = g_hash_table_size(hash_table);
-  if (size > 0) {
-    i = g_rand_int_range(rand, 0, size);
-    g_hash_table_iter_init(&iter, hash_table);
-
-    for (j = 0; j <= i && g_hash_table_iter_next(&iter, key, value); j++);
-  }
-}
-
-
 void push_rand_set_seed(push_t *push, int seed) {
   g_return_if_null(push);
 
@@ -96,7 +82,7 @@ push_instr_t *push_rand_instr(push_t *push) {
 
   g_return_val_if_null(push, NULL);
 
-  g_hash_table_random(push->rand, push->instructions, NULL, (void*)&instr);
+  instr = push_instrset_sample(push->instructions, push->rand);
 
   g_warn_if_fail(instr != NULL);
 
@@ -126,23 +112,25 @@ push_name_t push_rand_name(push_t *push) {
   /* 0-terminator */
   buf[i] = 0;
 
-  /* intern name, free buf and return interned name */
-  name = push_intern_name(push, buf);
+  /* NOTE: random names aren't interned, so they don't stay in the name
+   *       table forever
+   */
+  name = push_name_new(buf);
   g_free(buf);
   return name;
 }
 
 
 push_name_t push_rand_bound_name(push_t *push) {
-  push_name_t name = NULL;
+  push_int_t n;
 
-  g_hash_table_random(push->rand, push->bindings, (void*)&name, NULL);
-  if (name == NULL) {
+  n = push_num_bound(push);
+  if (n == 0) {
     /* no names defined */
-    name = push_rand_name(push);
+    return push_rand_name(push);
   }
 
-  return name;
+  return push_nth_bound(push, g_rand_int_range(push->rand, 0, n));
 }
 
 
@@ -200,11 +188,11 @@ push_val_t *push_rand_val(push_t *push, int type, push_int_t *size, push_bool_t
     case PUSH_TYPE_NAME:
       p = push_config_get(push, "NEW-ERC-NAME-PROBABILITY");
       if (p != NULL && push_check_real(p)) {
-        val->name = g_rand_double(push->rand) < p->real ? push_rand_name(push) : push_rand_bound_name(push);
+        val->name = push_name_ref(g_rand_double(push->rand) < p->real ? push_rand_name(push) : push_rand_bound_name(push));
       }
       else {
         g_warning("Configuration value 'NEW-ERC-NAME-PROBABILITY' is not a real number");
-        val->name = push_rand_name(push);
+        val->name = push_name_ref(push_rand_name(push));
       }
       break;
 
@@ -31,13 +31,13 @@
 #define str_bool(b)   ((b) ? "TRUE" : "FALSE")
 
 
-void push_serialize_val(GString *xml, int ident_count, push_val_t *val) {
-  char *ident;
-
-  g_return_if_null(val);
+/* serialize value, for code only the opening tag */
+static void push_serialize_val_open(GString *xml, int ident_count, push_val_t *val) {
+  push_instr_t **parts;
+  char *ident, *escaped;
+  guint i;
 
   ident = make_ident(ident_count);
-  ident_count++;
 
   switch (val->type) {
     case PUSH_TYPE_BOOL:
@@ -46,8 +46,6 @@ void push_serialize_val(GString *xml, int ident_count, push_val_t *val) {
 
     case PUSH_TYPE_CODE:
       g_string_append_printf(xml, "%s<code>\n", ident);
-      push_serialize_code(xml, ident_count, val->code);
-      g_string_append_printf(xml, "%s</code>\n", ident);
       break;
 
     case PUSH_TYPE_INT:
@@ -55,7 +53,15 @@ void push_serialize_val(GString *xml, int ident_count, push_val_t *val) {
       break;
 
     case PUSH_TYPE_INSTR:
-      g_string_append_printf(xml, "%s<instr name=\"%s\" />\n", ident, val->instr->name);
+      if (val->instr->parts != NULL) {
+        /* superinstruction is written as its parts */
+        for (parts = val->instr->parts; *parts != NULL; parts++) {
+          g_string_append_printf(xml, "%s<instr name=\"%s\" />\n", ident, (*parts)->name);
+        }
+      }
+      else {
+        g_string_append_printf(xml, "%s<instr name=\"%s\" />\n", ident, val->instr->name);
+      }
       break;
 
     case PUSH_TYPE_NAME:
@@ -65,25 +71,110 @@ void push_serialize_val(GString *xml, int ident_count, push_val_t *val) {
     case PUSH_TYPE_REAL:
       g_string_append_printf(xml, "%s<real value=\"%f\" />\n", ident, val->real);
       break;
+
+    case PUSH_TYPE_INTVEC:
+      /* elements separated by spaces */
+      g_string_append_printf(xml, "%s<intvec value=\"", ident);
+      for (i = 0; i < val->vec->len; i++) {
+        g_string_append_printf(xml, i == 0 ? "%d" : " %d", push_vec_ints(val->vec)[i]);
+      }
+      g_string_append(xml, "\" />\n");
+      break;
+
+    case PUSH_TYPE_REALVEC:
+      g_string_append_printf(xml, "%s<realvec value=\"", ident);
+      for (i = 0; i < val->vec->len; i++) {
+        g_string_append_printf(xml, i == 0 ? "%f" : " %f", push_vec_reals(val->vec)[i]);
+      }
+      g_string_append(xml, "\" />\n");
+      break;
+
+    case PUSH_TYPE_STRING:
+      escaped = g_markup_escape_text(val->str->data, val->str->length);
+      g_string_append_printf(xml, "%s<string value=\"%s\" />\n", ident, escaped);
+      g_free(escaped);
+      break;
   }
 
   free_ident(ident);
 }
 
 
+static void push_serialize_code_close(GString *xml, int ident_count) {
+  char *ident;
+
+  ident = make_ident(ident_count);
+  g_string_append_printf(xml, "%s</code>\n", ident);
+  free_ident(ident);
+}
+
+
+void push_serialize_val(GString *xml, int ident_count, push_val_t *val) {
+  g_return_if_null(val);
+
+  push_serialize_val_open(xml, ident_count, val);
+
+  if (push_check_code(val)) {
+    push_serialize_code(xml, ident_count + 1, val->code);
+    push_serialize_code_close(xml, ident_count);
+  }
+}
+
+
+/* NOTE: Walks code without recursion, open counts the <code> tags opened
+ *       for sub-code that aren't closed yet
+ */
 void push_serialize_code(GString *xml, int ident_count, push_code_t *code) {
-  GList *link;
+  push_code_walk_t walk;
+  push_val_t *val;
+  int depth, open = 0;
 
   g_return_if_null(code);
 
-  for (link = code->head; link != NULL; link = link->next) {
-    push_serialize_val(xml, ident_count, link->data);
+  push_code_walk_init(&walk, code);
+
+  while ((val = push_code_walk_next(&walk)) != NULL) {
+    depth = push_code_walk_depth(&walk);
+
+    /* close finished sub-code */
+    while (open > depth) {
+      open--;
+      push_serialize_code_close(xml, ident_count + open);
+    }
+
+    push_serialize_val_open(xml, ident_count + depth, val);
+
+    if (push_check_code(val)) {
+      if (val->code->head != NULL) {
+        /* walk descends on it next */
+        open++;
+      }
+      else {
+        push_serialize_code_close(xml, ident_count + depth);
+      }
+    }
+  }
+
+  while (open > 0) {
+    open--;
+    push_serialize_code_close(xml, ident_count + open);
   }
+
+  push_code_walk_clear(&walk);
 }
 
 
+struct push_serialize_stack_args {
+  GString *xml;
+  int ident_count;
+};
+
+static void push_serialize_stack_val(push_val_t *val, struct push_serialize_stack_args *args) {
+  push_serialize_val(args->xml, args->ident_count, val);
+}
+
 void push_serialize_stack(GString *xml, int ident_count, const char *name, push_stack_t *stack) {
-  GList *link;
+  struct push_serialize_stack_args args;
   char *ident;
 
   g_return_if_null(stack);
@@ -93,9 +184,9 @@ void push_serialize_stack(GString *xml, int ident_count, const char *name, push_
 
   g_string_append_printf(xml, "%s<stack name=\"%s\">\n", ident, name);
 
-  for (link = stack->head; link != NULL; link = link->next) {
-    push_serialize_val(xml, ident_count, (push_val_t*)link->data);
-  }
+  args.xml = xml;
+  args.ident_count = ident_count;
+  push_stack_foreach(stack, (GFunc)push_serialize_stack_val, &args);
 
   g_string_append_printf(xml, "%s</stack>\n", ident);
 
@@ -104,25 +195,39 @@ void push_serialize_stack(GString *xml, int ident_count, const char *name, push_
 }
 
 
-static void push_serialize_dict(GString *xml, int ident_count, const char *item_name, GHashTable *dict) {
+static void push_serialize_item(GString *xml, int ident_count, const char *item_name, const char *name, push_val_t *val) {
   char *ident;
+
+  if (val->type != PUSH_TYPE_INSTR) {
+    ident = make_ident(ident_count);
+    g_string_append_printf(xml, "%s<%s name=\"%s\">\n", ident, item_name, name);
+    push_serialize_val(xml, ident_count + 1, val);
+    g_string_append_printf(xml, "%s</%s>\n", ident, item_name);
+    free_ident(ident);
+  }
+}
+
+
+static void push_serialize_dict(GString *xml, int ident_count, const char *item_name, GHashTable *dict) {
   GHashTableIter iter;
   push_name_t name;
   push_val_t *val;
 
-  ident = make_ident(ident_count);
-  ident_count++;
-
   g_hash_table_iter_init(&iter, dict);
   while (g_hash_table_iter_next(&iter, (void*)&name, (void*)&val)) {
-    if (val->type != PUSH_TYPE_INSTR) {
-      g_string_append_printf(xml, "%s<%s name=\"%s\">\n", ident, item_name, name);
-      push_serialize_val(xml, ident_count, val);
-      g_string_append_printf(xml, "%s</%s>\n", ident, item_name);
-    }
+    push_serialize_item(xml, ident_count, item_name, name, val);
   }
+}
 
-  free_ident(ident);
+
+static void push_serialize_bindings(GString *xml, int ident_count, push_t *push) {
+  push_name_t name;
+  push_int_t i;
+
+  for (i = 0; i < push_num_bound(push); i++) {
+    name = push_nth_bound(push, i);
+    push_serialize_item(xml, ident_count, "binding", name, push_lookup(push, name));
+  }
 }
 
 
@@ -138,7 +243,7 @@ void push_serialize(GString *xml, int ident_count, push_t *push) {
   g_string_append_printf(xml, "%s<state>\n", ident);
 
   push_serialize_dict(xml, ident_count, "config", push->config);
-  push_serialize_dict(xml, ident_count, "binding", push->bindings);
+  push_serialize_bindings(xml, ident_count, push);
 
   push_serialize_stack(xml, ident_count, "boolean", push->boolean);
   push_serialize_stack(xml, ident_count, "code", push->code);
@@ -146,6 +251,9 @@ void push_serialize(GString *xml, int ident_count, push_t *push) {
   push_serialize_stack(xml, ident_count, "integer", push->integer);
   push_serialize_stack(xml, ident_count, "name", push->name);
   push_serialize_stack(xml, ident_count, "real", push->real);
+  push_serialize_stack(xml, ident_count, "intvec", push->intvec);
+  push_serialize_stack(xml, ident_count, "realvec", push->realvec);
+  push_serialize_stack(xml, ident_count, "string", push->string);
 
   g_string_append_printf(xml, "%s</state>\n", ident);
 
@@ -0,0 +1,343 @@
+/* simplify.c - Program simplifier
+ * NOTE: Removes code that provably doesn't change the outcome of a program:
+ *       instructions that would find too few values on their stacks,
+ *       duplicates that are popped right away, empty lists, and instructions
+ *       that only take literals, which are replaced by their results.
+ *
+ * Copyright (c) 2012 Janosch Gräf <janosch.graef@gmx.net>
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "push.h"
+
+
+
+/* State of a simplification */
+struct push_simplify_S {
+  /* bounds of all stack depths at the current point of the program */
+  push_int_t lo[PUSH_STACK_NUM];
+  push_int_t hi[PUSH_STACK_NUM];
+
+  /* if instructions with unknown effects were passed (e.g. they could
+   * have bound names)
+   */
+  push_bool_t unknown;
+
+  /* if the rest of the program must stay as it is */
+  push_bool_t stop;
+
+  /* interpreter to compute the results of folded instructions, or NULL */
+  push_t *push;
+  push_t *scratch;
+};
+
+
+/* Returns stack (PUSH_STACK_*) a literal is pushed to, or -1 */
+static push_int_t push_simplify_literal(push_val_t *val) {
+  switch (val->type) {
+    case PUSH_TYPE_BOOL:
+      return PUSH_STACK_BOOL;
+    case PUSH_TYPE_INT:
+      return PUSH_STACK_INT;
+    case PUSH_TYPE_NAME:
+      return PUSH_STACK_NAME;
+    case PUSH_TYPE_REAL:
+      return PUSH_STACK_REAL;
+    case PUSH_TYPE_INTVEC:
+      return PUSH_STACK_INTVEC;
+    case PUSH_TYPE_REALVEC:
+      return PUSH_STACK_REALVEC;
+    case PUSH_TYPE_STRING:
+      return PUSH_STACK_STRING;
+    default:
+      return -1;
+  }
+}
+
+
+/* replace instruction at link and the literals before it by its results,
+ * if it only takes these literals
+ */
+static push_bool_t push_simplify_fold(struct push_simplify_S *s, push_code_t *code, GList *link) {
+  push_instr_t *instr = ((push_val_t*)link->data)->instr;
+  push_int_t counts[PUSH_STACK_NUM] = { 0 };
+  push_int_t i, j, n, num_pops = 0, num_results = 0;
+  push_stack_t *stack;
+  GList *first;
+
+  /* only instructions with a known effect and no side effects */
+  if (instr->effect == NULL || instr->unchecked == NULL) {
+    return FALSE;
+  }
+
+  for (i = 0; i < PUSH_STACK_NUM; i++) {
+    num_pops += instr->effect->pops[i];
+  }
+
+  /* preceding values must be exactly the literals it takes */
+  for (n = 0, first = link; n < num_pops && first->prev != NULL; n++) {
+    first = first->prev;
+    i = push_simplify_literal((push_val_t*)first->data);
+    if (i < 0 || ++counts[i] > instr->effect->pops[i]) {
+      return FALSE;
+    }
+  }
+  if (n < num_pops) {
+    return FALSE;
+  }
+
+  /* run the instruction on them */
+  if (s->scratch == NULL) {
+    s->scratch = push_new_full(FALSE, FALSE, s->push->gc, NULL, NULL);
+    g_static_mutex_lock(&s->scratch->mutex);
+  }
+  for (; first != link; first = first->next) {
+    push_do_val(s->scratch, (push_val_t*)first->data);
+  }
+  push_instr_call(s->scratch, instr);
+
+  /* results must be literals and not take more space than before */
+  for (i = 0; i < PUSH_STACK_NUM; i++) {
+    counts[i] = push_stack_length(push_instr_get_stack(s->scratch, i));
+    num_results += counts[i];
+    if (counts[i] > 0 && (i == PUSH_STACK_CODE || i == PUSH_STACK_EXEC)) {
+      num_results = G_MAXINT;
+      break;
+    }
+  }
+
+  if (num_results > num_pops + 1) {
+    push_flush(s->scratch);
+    return FALSE;
+  }
+
+  /* replace literals by results */
+  for (n = 0; n < num_pops; n++) {
+    g_queue_delete_link(code, link->prev);
+  }
+
+  for (i = 0; i < PUSH_STACK_NUM; i++) {
+    stack = push_instr_get_stack(s->scratch, i);
+    for (j = counts[i] - 1; j >= 0; j--) {
+      g_queue_insert_before(code, link, push_val_copy(push_stack_peek_nth(stack, j), s->push));
+    }
+
+    /* NOTE: the literals were already counted */
+    s->lo[i] += counts[i] - instr->effect->pops[i];
+    if (s->hi[i] != G_MAXINT) {
+      s->hi[i] += counts[i] - instr->effect->pops[i];
+    }
+  }
+
+  g_queue_delete_link(code, link);
+  push_flush(s->scratch);
+
+  return TRUE;
+}
+
+
+/* check if instruction is a POLY instruction with the given name (e.g. ".DUP"),
+ * that takes pops and pushes pushes values on stack and nothing else
+ */
+static push_bool_t push_simplify_is(push_instr_t *instr, const char *type, push_int_t stack, push_int_t pops, push_int_t pushes) {
+  const char *type2 = strchr(instr->name, '.');
+  push_int_t i;
+
+  if (instr->effect == NULL || type2 == NULL || strcmp(type, type2) != 0) {
+    return FALSE;
+  }
+
+  for (i = 0; i < PUSH_STACK_NUM; i++) {
+    if (instr->effect->pops[i] != (i == stack ? pops : 0) || instr->effect->pushes_max[i] != (i == stack ? pushes : 0) ||
+        instr->effect->pushes[i] != instr->effect->pushes_max[i]) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+
+/* check if instruction at link is a DUP, that is popped right away
+ * NOTE: if the DUP doesn't run, the stack is empty and the POP doesn't run
+ *       either
+ */
+static push_bool_t push_simplify_dup_pop(GList *link) {
+  push_instr_t *instr1, *instr2;
+  push_int_t i;
+
+  if (link->next == NULL || !push_check_instr((push_val_t*)link->next->data)) {
+    return FALSE;
+  }
+
+  instr1 = ((push_val_t*)link->data)->instr;
+  instr2 = ((push_val_t*)link->next->data)->instr;
+
+  for (i = 0; i < PUSH_STACK_NUM; i++) {
+    if (push_simplify_is(instr1, ".DUP", i, 1, 2)) {
+      return push_simplify_is(instr2, ".POP", i, 1, 0);
+    }
+  }
+
+  return FALSE;
+}
+
+
+/* List being simplified, while push_simplify_code walks into it */
+struct push_simplify_frame_S {
+  /* the list, and its link in the enclosing list (or NULL) */
+  push_code_t *code;
+  GList *link;
+
+  /* next link of the list to look at */
+  GList *next;
+};
+
+
+/* simplify code (in place), that's executed with the current bounds
+ * NOTE: Stops at the first value, that could see the rest of the program on
+ *       the EXEC stack. Code before it has run by then, so it can still be
+ *       simplified. Nested lists are walked with an explicit stack, so
+ *       deeply nested code doesn't overflow the C stack.
+ */
+static void push_simplify_code(struct push_simplify_S *s, push_code_t *code) {
+  struct push_simplify_frame_S frame, *top;
+  GArray *frames;
+  GList *link;
+  push_val_t *val;
+  push_int_t i;
+
+  frames = g_array_new(FALSE, FALSE, sizeof(struct push_simplify_frame_S));
+  frame.code = code;
+  frame.link = NULL;
+  frame.next = code->head;
+  g_array_append_val(frames, frame);
+
+  while (frames->len > 0) {
+    top = &g_array_index(frames, struct push_simplify_frame_S, frames->len - 1);
+    code = top->code;
+    link = top->next;
+
+    if (link == NULL || s->stop) {
+      /* done with this list: drop it from the enclosing list, if it's empty
+       * NOTE: lists are executed in place and the simplified copy is only
+       *       referenced here
+       */
+      frame = *top;
+      g_array_set_size(frames, frames->len - 1);
+      if (frame.link != NULL && frame.code->length == 0) {
+        g_queue_delete_link(g_array_index(frames, struct push_simplify_frame_S, frames->len - 1).code, frame.link);
+      }
+      continue;
+    }
+
+    top->next = link->next;
+    val = (push_val_t*)link->data;
+
+    if (push_check_code(val)) {
+      frame.code = val->code;
+      frame.link = link;
+      frame.next = val->code->head;
+      g_array_append_val(frames, frame);
+    }
+    else if (push_check_name(val) && (s->unknown || push_lookup(s->push, val->name) != NULL)) {
+      /* could run any code */
+      s->stop = TRUE;
+    }
+    else if (push_check_instr(val) && !(val->instr->flags & PUSH_INSTR_FUSABLE)) {
+      s->stop = TRUE;
+    }
+    else if (push_check_instr(val)) {
+      if (val->instr->effect == NULL) {
+        s->unknown = TRUE;
+      }
+
+      if (push_simplify_fold(s, code, link)) {
+        continue;
+      }
+      else if (push_simplify_dup_pop(link)) {
+        top->next = top->next->next;
+        g_queue_delete_link(code, link->next);
+        g_queue_delete_link(code, link);
+      }
+      else if (push_instr_effect_step(val->instr, s->lo, s->hi) == PUSH_INSTR_NOOP) {
+        g_queue_delete_link(code, link);
+      }
+    }
+    else if ((i = push_simplify_literal(val)) >= 0) {
+      s->lo[i]++;
+      if (s->hi[i] != G_MAXINT) {
+        s->hi[i]++;
+      }
+    }
+  }
+
+  g_array_free(frames, TRUE);
+}
+
+
+/* Returns copy of program without code that provably has no effect, if it's
+ * run on the current stacks and bindings of the interpreter (stores number of
+ * removed points in removed, if not NULL)
+ * NOTE: Apart from needing fewer steps, the simplified program does exactly
+ *       the same. Values that aren't code are returned as they are.
+ */
+push_val_t *push_simplify(push_t *push, push_val_t *val, push_int_t *removed) {
+  struct push_simplify_S s;
+  push_val_t *new_val;
+  push_int_t i;
+
+  g_return_val_if_null(push, NULL);
+  g_return_val_if_null(val, NULL);
+
+  if (removed != NULL) {
+    *removed = 0;
+  }
+
+  if (!push_check_code(val)) {
+    return val;
+  }
+
+  /* the program starts with the stacks as they are */
+  for (i = 0; i < PUSH_STACK_NUM; i++) {
+    s.lo[i] = s.hi[i] = push_stack_length(push_instr_get_stack(push, i));
+  }
+  s.unknown = FALSE;
+  s.stop = FALSE;
+  s.push = push;
+  s.scratch = NULL;
+
+  new_val = push_val_copy(val, push);
+  push_simplify_code(&s, new_val->code);
+
+  if (s.scratch != NULL) {
+    g_static_mutex_unlock(&s.scratch->mutex);
+    push_destroy(s.scratch);
+  }
+
+  if (removed != NULL) {
+    *removed = push_code_size(val->code) - push_code_size(new_val->code);
+  }
+
+  return new_val;
+}
@@ -1,5 +1,7 @@
 /* stack.c - Stacks
- * NOTE: Just wrappers for the GLib GQueue functions
+ * NOTE: Mostly wrappers for the GLib GQueue functions. Executed code is put on
+ *       the stack as a cursor (see push_stack_push_code), which the other
+ *       stack functions expand as far as they need to.
  *
  * Copyright (c) 2012 Janosch Gräf <janosch.graef@gmx.net>
  * Permission is hereby granted, free of charge, to any person obtaining a copy
@@ -27,61 +29,296 @@
 
 
 
+static push_cursor_t *push_cursor_new(push_val_t *val) {
+  push_cursor_t *cursor;
+
+  cursor = g_slice_new(push_cursor_t);
+  cursor->type = PUSH_TYPE_CURSOR;
+  cursor->remaining = val->code->length;
+  cursor->val = val;
+  cursor->link = val->code->head;
+
+  return cursor;
+}
+
+static void push_cursor_destroy(push_cursor_t *cursor) {
+  g_slice_free(push_cursor_t, cursor);
+}
+
+/* return next element of cursor and advance it */
+static push_val_t *push_cursor_next(push_cursor_t *cursor) {
+  push_val_t *val;
+
+  val = (push_val_t*)cursor->link->data;
+  cursor->link = cursor->link->next;
+  cursor->remaining--;
+
+  return val;
+}
+
+
+/* make sure the first n entries of stack are values (not cursors) */
+static void push_stack_expand(push_stack_t *stack, push_int_t n) {
+  GList *link, *next_link;
+  push_cursor_t *cursor;
+  push_int_t i;
+
+  link = stack->values.head;
+
+  for (i = 0; i < n && link != NULL; i++) {
+    if (push_check_cursor((push_val_t*)link->data)) {
+      /* take next element out of the cursor, it's entry i now */
+      cursor = (push_cursor_t*)link->data;
+      g_queue_insert_before(&stack->values, link, push_cursor_next(cursor));
+
+      if (cursor->remaining == 0) {
+        next_link = link->next;
+        g_queue_delete_link(&stack->values, link);
+        push_cursor_destroy(cursor);
+        link = next_link;
+      }
+    }
+    else {
+      link = link->next;
+    }
+  }
+}
+
+
 push_stack_t *push_stack_new(void) {
-  return g_queue_new();
+  push_stack_t *stack;
+
+  stack = g_slice_new(push_stack_t);
+  g_queue_init(&stack->values);
+  stack->length = 0;
+
+  return stack;
 }
 
 void push_stack_destroy(push_stack_t *stack) {
-  g_queue_free(stack);
+  push_stack_flush(stack);
+  g_slice_free(push_stack_t, stack);
 }
 
 void push_stack_push(push_stack_t *stack, push_val_t *val) {
   g_return_if_null(val);
 
-  g_queue_push_head(stack, val);
+  g_queue_push_head(&stack->values, val);
+  stack->length++;
+}
+
+/* push elements of code value, so that the first element is on top
+ * NOTE: the elements are only taken from the code when they are needed, so
+ *       this doesn't depend on the length of the code
+ */
+void push_stack_push_code(push_stack_t *stack, push_val_t *val) {
+  g_return_if_null(val);
+  g_return_if_fail(push_check_code(val));
+
+  if (val->code->length == 1) {
+    push_stack_push(stack, (push_val_t*)val->code->head->data);
+  }
+  else if (val->code->length > 1) {
+    g_queue_push_head(&stack->values, push_cursor_new(val));
+    stack->length += val->code->length;
+  }
 }
 
 void push_stack_push_nth(push_stack_t *stack, push_int_t n, push_val_t *val) {
   g_return_if_null(val);
 
-  g_queue_push_nth(stack, val, n);
+  if (n < 0 || n >= stack->length) {
+    g_queue_push_tail(&stack->values, val);
+  }
+  else {
+    push_stack_expand(stack, n);
+    g_queue_push_nth(&stack->values, val, n);
+  }
+  stack->length++;
 }
 
 push_val_t *push_stack_pop(push_stack_t *stack) {
-  return (push_val_t*)g_queue_pop_head(stack);
+  push_val_t *val;
+  push_cursor_t *cursor;
+
+  val = (push_val_t*)g_queue_peek_head(&stack->values);
+
+  if (val != NULL) {
+    if (push_check_cursor(val)) {
+      cursor = (push_cursor_t*)val;
+      val = push_cursor_next(cursor);
+
+      if (cursor->remaining == 0) {
+        g_queue_pop_head(&stack->values);
+        push_cursor_destroy(cursor);
+      }
+    }
+    else {
+      g_queue_pop_head(&stack->values);
+    }
+
+    stack->length--;
+  }
+
+  return val;
 }
 
 push_val_t *push_stack_pop_nth(push_stack_t *stack, push_int_t n) {
-  return (push_val_t*)g_queue_pop_nth(stack, n);
+  if (n < 0 || n >= stack->length) {
+    return NULL;
+  }
+
+  push_stack_expand(stack, n + 1);
+  stack->length--;
+
+  return (push_val_t*)g_queue_pop_nth(&stack->values, n);
 }
 
 push_val_t *push_stack_peek(push_stack_t *stack) {
-  return (push_val_t*)g_queue_peek_head(stack);
+  push_val_t *val;
+
+  val = (push_val_t*)g_queue_peek_head(&stack->values);
+
+  if (val != NULL && push_check_cursor(val)) {
+    val = (push_val_t*)((push_cursor_t*)val)->link->data;
+  }
+
+  return val;
 }
 
 push_val_t *push_stack_peek_nth(push_stack_t *stack, push_int_t n) {
-  return (push_val_t*)g_queue_peek_nth(stack, n);
+  if (n < 0 || n >= stack->length) {
+    return NULL;
+  }
+
+  push_stack_expand(stack, n + 1);
+
+  return (push_val_t*)g_queue_peek_nth(&stack->values, n);
 }
 
 int push_stack_length(push_stack_t *stack) {
   return stack->length;
 }
 
-void push_stack_flush(push_stack_t *stack) {
-  g_queue_clear(stack);
+/* push n values of type BOOL, INT or REAL from data (array of push_bool_t,
+ * push_int_t or push_real_t), so that data[n - 1] is on top
+ * NOTE: all values are created at once (see push_val_new_array)
+ */
+void push_stack_push_array(push_t *push, push_stack_t *stack, int type, const void *data, push_int_t n) {
+  push_val_t **vals;
+  push_int_t i;
+
+  g_return_if_null(data);
+
+  if (n <= 0) {
+    return;
+  }
+
+  vals = g_new(push_val_t*, n);
+  push_val_new_array(push, type, data, n, vals);
+
+  for (i = 0; i < n; i++) {
+    g_queue_push_head(&stack->values, vals[i]);
+  }
+  stack->length += n;
+
+  g_free(vals);
 }
 
+/* read the n top-most values of type BOOL, INT or REAL into data without
+ * popping them (the top one into data[n - 1]) and return n
+ * NOTE: if the stack has less than n values, all of them are read and their
+ *       number is returned. Reading stops at values of other types.
+ */
+push_int_t push_stack_read_array(push_stack_t *stack, int type, void *data, push_int_t n) {
+  push_val_t *val;
+  GList *link;
+  push_int_t i;
 
-push_stack_t *push_stack_copy(push_stack_t *stack, push_t *to_push) {
-  push_stack_t *new_stack;
+  g_return_val_if_null(data, 0);
+  g_return_val_if_fail(type == PUSH_TYPE_BOOL || type == PUSH_TYPE_INT || type == PUSH_TYPE_REAL, 0);
+
+  n = CLAMP(n, 0, stack->length);
+  push_stack_expand(stack, n);
+
+  for (i = 0, link = stack->values.head; i < n; i++, link = link->next) {
+    val = (push_val_t*)link->data;
+    if (val->type != type) {
+      break;
+    }
+  }
+  n = i;
+
+  /* copy, beginning with the top-most value */
+  for (i = n - 1, link = stack->values.head; i >= 0; i--, link = link->next) {
+    val = (push_val_t*)link->data;
+    switch (type) {
+      case PUSH_TYPE_BOOL:
+        ((push_bool_t*)data)[i] = val->boolean;
+        break;
+      case PUSH_TYPE_INT:
+        ((push_int_t*)data)[i] = val->integer;
+        break;
+      case PUSH_TYPE_REAL:
+        ((push_real_t*)data)[i] = val->real;
+        break;
+    }
+  }
+
+  return n;
+}
+
+void push_stack_flush(push_stack_t *stack) {
   GList *link;
 
-  new_stack = g_queue_new();
+  /* destroy cursors */
+  for (link = stack->values.head; link != NULL; link = link->next) {
+    if (push_check_cursor((push_val_t*)link->data)) {
+      push_cursor_destroy((push_cursor_t*)link->data);
+    }
+  }
+
+  g_queue_clear(&stack->values);
+  stack->length = 0;
+}
 
-  for (link = stack->head; link != NULL; link = link->next) {
-    g_queue_push_tail(new_stack, push_val_copy((push_val_t*)link->data, to_push));
+
+/* call func for each value on stack, from top to bottom */
+void push_stack_foreach(push_stack_t *stack, GFunc func, void *userdata) {
+  GList *link, *link2;
+  push_cursor_t *cursor;
+
+  for (link = stack->values.head; link != NULL; link = link->next) {
+    if (push_check_cursor((push_val_t*)link->data)) {
+      cursor = (push_cursor_t*)link->data;
+      for (link2 = cursor->link; link2 != NULL; link2 = link2->next) {
+        func(link2->data, userdata);
+      }
+    }
+    else {
+      func(link->data, userdata);
+    }
   }
+}
+
+
+struct push_stack_copy_args {
+  push_stack_t *stack;
+  push_t *to_push;
+};
 
-  return new_stack;
+static void push_stack_copy_val(push_val_t *val, struct push_stack_copy_args *args) {
+  g_queue_push_tail(&args->stack->values, push_val_copy(val, args->to_push));
+  args->stack->length++;
 }
 
+push_stack_t *push_stack_copy(push_stack_t *stack, push_t *to_push) {
+  struct push_stack_copy_args args = {
+    .stack = push_stack_new(),
+    .to_push = to_push
+  };
+
+  push_stack_foreach(stack, (GFunc)push_stack_copy_val, &args);
+
+  return args.stack;
+}
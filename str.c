@@ -0,0 +1,182 @@
+/* str.c - Immutable strings
+ * NOTE: Strings are shared between values instead of being copied. Strings
+ *       are treated as bytes, not as UTF-8 characters.
+ *
+ * Copyright (c) 2012 Janosch Gräf <janosch.graef@gmx.net>
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "push.h"
+
+
+
+/* Returns new string with a copy of length bytes of data
+ * NOTE: if length is negative, data is NUL-terminated. If data is NULL, the
+ *       bytes are left uninitialized.
+ */
+push_str_t *push_str_new(const char *data, push_int_t length) {
+  push_str_t *str;
+  char *buf;
+
+  if (length < 0) {
+    length = data != NULL ? strlen(data) : 0;
+  }
+
+  /* store data right after the struct */
+  str = (push_str_t*)g_malloc(sizeof(push_str_t) + length + 1);
+  buf = (char*)(str + 1);
+  if (data != NULL && length > 0) {
+    memcpy(buf, data, length);
+  }
+  buf[length] = '\0';
+
+  str->ref_count = 1;
+  str->length = length;
+  str->data = buf;
+  str->base = NULL;
+
+  return str;
+}
+
+
+push_str_t *push_str_ref(push_str_t *str) {
+  g_return_val_if_null(str, NULL);
+
+  g_atomic_int_inc(&str->ref_count);
+
+  return str;
+}
+
+
+void push_str_unref(push_str_t *str) {
+  g_return_if_null(str);
+
+  if (g_atomic_int_dec_and_test(&str->ref_count)) {
+    if (str->base != NULL) {
+      push_str_unref(str->base);
+    }
+    g_free(str);
+  }
+}
+
+
+/* Returns the bytes start, ..., end - 1 of str (clamped to the string)
+ * NOTE: larger substrings refer to the data of str instead of copying it
+ */
+push_str_t *push_str_sub(push_str_t *str, push_int_t start, push_int_t end) {
+  push_str_t *sub;
+
+  g_return_val_if_null(str, NULL);
+
+  start = CLAMP(start, 0, str->length);
+  end = CLAMP(end, start, str->length);
+
+  if (start == 0 && end == str->length) {
+    return push_str_ref(str);
+  }
+  else if (end - start <= PUSH_STR_SMALL) {
+    return push_str_new(str->data + start, end - start);
+  }
+
+  sub = g_new(push_str_t, 1);
+  sub->ref_count = 1;
+  sub->length = end - start;
+  sub->data = str->data + start;
+  sub->base = push_str_ref(str->base != NULL ? str->base : str);
+
+  return sub;
+}
+
+
+push_str_t *push_str_concat(push_str_t *str1, push_str_t *str2) {
+  push_str_t *str;
+
+  g_return_val_if_null(str1, NULL);
+  g_return_val_if_null(str2, NULL);
+
+  if (str1->length == 0) {
+    return push_str_ref(str2);
+  }
+  else if (str2->length == 0) {
+    return push_str_ref(str1);
+  }
+
+  str = push_str_new(NULL, str1->length + str2->length);
+  memcpy((char*)str->data, str1->data, str1->length);
+  memcpy((char*)str->data + str1->length, str2->data, str2->length);
+
+  return str;
+}
+
+
+/* Returns index of first occurrence of needle in haystack or -1 */
+push_int_t push_str_find(push_str_t *haystack, push_str_t *needle) {
+  const char *p, *last;
+
+  g_return_val_if_null(haystack, -1);
+  g_return_val_if_null(needle, -1);
+
+  if (needle->length == 0) {
+    return 0;
+  }
+  else if (needle->length > haystack->length) {
+    return -1;
+  }
+
+  /* candidates start with the first byte of needle */
+  last = haystack->data + (haystack->length - needle->length);
+  for (p = haystack->data; p <= last; p++) {
+    p = (const char*)memchr(p, needle->data[0], last - p + 1);
+    if (p == NULL) {
+      break;
+    }
+    if (memcmp(p, needle->data, needle->length) == 0) {
+      return p - haystack->data;
+    }
+  }
+
+  return -1;
+}
+
+
+push_bool_t push_str_equal(push_str_t *str1, push_str_t *str2) {
+  g_return_val_if_null(str1, FALSE);
+  g_return_val_if_null(str2, FALSE);
+
+  return str1->length == str2->length && (str1->data == str2->data || memcmp(str1->data, str2->data, str1->length) == 0);
+}
+
+
+guint push_str_hash(push_str_t *str) {
+  guint h = 5381;
+  push_int_t i;
+
+  g_return_val_if_null(str, 0);
+
+  for (i = 0; i < str->length; i++) {
+    h = h * 33 + (guchar)str->data[i];
+  }
+
+  return h;
+}
+
@@ -62,6 +62,15 @@ static push_stack_t *push_unserialize_name2stack(push_t *push, const char *name)
   else if (strcmp(name, "real") == 0) {
     return push->real;
   }
+  else if (strcmp(name, "intvec") == 0) {
+    return push->intvec;
+  }
+  else if (strcmp(name, "realvec") == 0) {
+    return push->realvec;
+  }
+  else if (strcmp(name, "string") == 0) {
+    return push->string;
+  }
   else {
     return NULL;
   }
@@ -89,7 +98,7 @@ static void push_unserialize_add_value(struct push_unserialize_args *args, push_
     push_code_append(val2->code, val);
   }
   else if (args->current_stack != NULL) {
-    g_queue_push_tail(args->current_stack, val);
+    push_stack_push_nth(args->current_stack, -1, val);
   }
   else if (args->current_binding != NULL) {
     push_define(args->push, args->current_binding, val);
@@ -104,6 +113,37 @@ static void push_unserialize_add_value(struct push_unserialize_args *args, push_
 }
 
 
+/* parse vector elements separated by spaces */
+static push_val_t *push_unserialize_vec(push_t *push, push_bool_t is_int, const char *str) {
+  push_vec_t *vec;
+  push_int_t i;
+  push_real_t r;
+  char *end;
+
+  vec = is_int ? push_vec_new_int(0) : push_vec_new_real(0);
+
+  while (TRUE) {
+    if (is_int) {
+      i = (push_int_t)strtol(str, &end, 10);
+      if (end == str) {
+        break;
+      }
+      g_array_append_val(vec, i);
+    }
+    else {
+      r = strtod(str, &end);
+      if (end == str) {
+        break;
+      }
+      g_array_append_val(vec, r);
+    }
+    str = end;
+  }
+
+  return push_val_new(push, is_int ? PUSH_TYPE_INTVEC : PUSH_TYPE_REALVEC, vec);
+}
+
+
 static void push_unserialize_start_tag(GMarkupParseContext *ctx, const char *element_name, const char **attribute_names, const char **attribute_values, void *userdata, GError **error) {
   struct push_unserialize_args *args = (struct push_unserialize_args*)userdata;
   int type;
@@ -174,6 +214,20 @@ static void push_unserialize_start_tag(GMarkupParseContext *ctx, const char *ele
       push_unserialize_add_value(args, val);
     }
   }
+  else if (strcmp(element_name, "intvec") == 0 || strcmp(element_name, "realvec") == 0) {
+    val_str = push_unserialize_get_value(attribute_names, attribute_values, "value");
+    if (val_str != NULL) {
+      val = push_unserialize_vec(args->push, element_name[0] == 'i', val_str);
+      push_unserialize_add_value(args, val);
+    }
+  }
+  else if (strcmp(element_name, "string") == 0) {
+    val_str = push_unserialize_get_value(attribute_names, attribute_values, "value");
+    if (val_str != NULL) {
+      val = push_val_new(args->push, PUSH_TYPE_STRING, push_str_new(val_str, -1));
+      push_unserialize_add_value(args, val);
+    }
+  }
 }
 
 
@@ -23,6 +23,7 @@
 #include <glib.h>
 #include <string.h>
 #include <stdarg.h>
+#include <string.h>
 
 #include "push.h"
 
@@ -58,13 +59,35 @@ push_val_t *push_val_new(push_t *push, int type, ...) {
       break;
 
     case PUSH_TYPE_NAME:
-      val->name = va_arg(ap, push_name_t);
+      val->name = push_name_ref(va_arg(ap, push_name_t));
       break;
 
     case PUSH_TYPE_REAL:
       val->real = va_arg(ap, push_real_t);
       break;
 
+    case PUSH_TYPE_INTVEC:
+      val->vec = va_arg(ap, push_vec_t*);
+      if (val->vec == NULL) {
+        val->vec = push_vec_new_int(0);
+      }
+      break;
+
+    case PUSH_TYPE_REALVEC:
+      val->vec = va_arg(ap, push_vec_t*);
+      if (val->vec == NULL) {
+        val->vec = push_vec_new_real(0);
+      }
+      break;
+
+    case PUSH_TYPE_STRING:
+      /* NOTE: takes the reference to the string */
+      val->str = va_arg(ap, push_str_t*);
+      if (val->str == NULL) {
+        val->str = push_str_new(NULL, 0);
+      }
+      break;
+
     default:
       val->type = PUSH_TYPE_NONE;
       break;
@@ -80,28 +103,75 @@ push_val_t *push_val_new(push_t *push, int type, ...) {
 }
 
 
-push_val_t *push_val_copy(push_val_t *val, push_t *to_push) {
+/* Create n values of type BOOL, INT or REAL from data (array of push_bool_t,
+ * push_int_t or push_real_t) and store them in vals
+ * NOTE: all values are added to garbage collection with a single message
+ */
+void push_val_new_array(push_t *push, int type, const void *data, push_int_t n, push_val_t **vals) {
+  push_int_t i;
+
+  g_return_if_null(data);
+  g_return_if_null(vals);
+  g_return_if_fail(type == PUSH_TYPE_BOOL || type == PUSH_TYPE_INT || type == PUSH_TYPE_REAL);
+
+  for (i = 0; i < n; i++) {
+    vals[i] = g_slice_new(push_val_t);
+    vals[i]->type = type;
+  }
+
+  switch (type) {
+    case PUSH_TYPE_BOOL:
+      for (i = 0; i < n; i++) {
+        vals[i]->boolean = ((const push_bool_t*)data)[i];
+      }
+      break;
+
+    case PUSH_TYPE_INT:
+      for (i = 0; i < n; i++) {
+        vals[i]->integer = ((const push_int_t*)data)[i];
+      }
+      break;
+
+    case PUSH_TYPE_REAL:
+      for (i = 0; i < n; i++) {
+        vals[i]->real = ((const push_real_t*)data)[i];
+      }
+      break;
+  }
+
+  /* add to garbage collection */
+  if (push != NULL) {
+    push_gc_add_vals(push->gc, vals, n);
+  }
+}
+
+
+/* copy a single value, but not the values in its code */
+static push_val_t *push_val_copy_shallow(push_val_t *val, push_t *to_push) {
   push_val_t *new_val;
-  push_code_t *new_code;
-  GList *link;
 
   new_val = push_val_new(to_push, PUSH_TYPE_NONE);
   new_val->type = val->type;
 
   if (push_check_code(val)) {
-    /* copy code */
-    new_code = push_code_new();
-
-    for (link = val->code->head; link != NULL; link = link->next) {
-      push_code_append(new_code, push_val_copy((push_val_t*)link->data, to_push));
-    }
-
-    new_val->code = new_code;
+    new_val->code = push_code_new();
   }
   else if (push_check_instr(val)) {
-    new_val->instr = push_instr_lookup(to_push, val->instr->name);
+    /* NOTE: interpreters usually share their instruction set */
+    new_val->instr = to_push == NULL || push_instrset_get(to_push->instructions, val->instr->opcode) == val->instr ? val->instr : push_instr_lookup(to_push, val->instr->name);
     g_return_val_if_null(new_val->instr, NULL);
   }
+  else if (push_check_vec(val)) {
+    new_val->vec = push_vec_dup(val->vec);
+  }
+  else if (push_check_string(val)) {
+    /* strings are never changed, so they can be shared */
+    new_val->str = push_str_ref(val->str);
+  }
+  else if (push_check_name(val)) {
+    new_val->name = push_name_ref(val->name);
+  }
+
   else {
     new_val->_value = val->_value;
   }
@@ -110,17 +180,84 @@ push_val_t *push_val_copy(push_val_t *val, push_t *to_push) {
 }
 
 
+push_val_t *push_val_copy(push_val_t *val, push_t *to_push) {
+  push_val_t *new_val, *val2, *new_val2;
+  push_code_walk_t walk;
+  GPtrArray *new_path;
+
+  new_val = push_val_copy_shallow(val, to_push);
+
+  if (new_val != NULL && push_check_code(val)) {
+    /* copy code without recursion: new_path holds the copied code
+     * containing the current value at each depth of the walk
+     */
+    new_path = g_ptr_array_new();
+    g_ptr_array_add(new_path, new_val->code);
+
+    push_code_walk_init(&walk, val->code);
+    while ((val2 = push_code_walk_next(&walk)) != NULL) {
+      g_ptr_array_set_size(new_path, push_code_walk_depth(&walk) + 1);
+
+      new_val2 = push_val_copy_shallow(val2, to_push);
+      if (new_val2 != NULL) {
+        push_code_append((push_code_t*)g_ptr_array_index(new_path, new_path->len - 1), new_val2);
+
+        if (push_check_code(new_val2)) {
+          g_ptr_array_add(new_path, new_val2->code);
+        }
+      }
+      else {
+        /* skip anything in a value that couldn't be copied */
+        push_code_walk_skip(&walk);
+      }
+    }
+    push_code_walk_clear(&walk);
+
+    g_ptr_array_free(new_path, TRUE);
+  }
+
+  return new_val;
+}
+
+
 void push_val_destroy(push_val_t *val) {
   g_return_if_null(val);
 
   if (push_check_code(val)) {
     push_code_destroy(val->code);
   }
+  else if (push_check_vec(val)) {
+    push_vec_destroy(val->vec);
+  }
+  else if (push_check_string(val)) {
+    push_str_unref(val->str);
+  }
+  else if (push_check_name(val)) {
+    push_name_unref(val->name);
+  }
 
   g_slice_free(push_val_t, val);
 }
 
 
+/* compare real vectors like reals (e.g. 0.0 == -0.0) */
+static push_bool_t push_val_realvec_equal(push_vec_t *vec1, push_vec_t *vec2) {
+  guint i;
+
+  if (vec1->len != vec2->len) {
+    return FALSE;
+  }
+
+  for (i = 0; i < vec1->len; i++) {
+    if (push_vec_reals(vec1)[i] != push_vec_reals(vec2)[i]) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+
 push_bool_t push_val_equal(push_val_t *val1, push_val_t *val2) {
   g_return_val_if_null(val1, FALSE);
   g_return_val_if_null(val2, FALSE);
@@ -147,6 +284,12 @@ push_bool_t push_val_equal(push_val_t *val1, push_val_t *val2) {
         return val1->name == val2->name;
       case PUSH_TYPE_REAL:
         return val1->real == val2->real;
+      case PUSH_TYPE_INTVEC:
+        return val1->vec->len == val2->vec->len && memcmp(val1->vec->data, val2->vec->data, val1->vec->len * sizeof(push_int_t)) == 0;
+      case PUSH_TYPE_REALVEC:
+        return push_val_realvec_equal(val1->vec, val2->vec);
+      case PUSH_TYPE_STRING:
+        return push_str_equal(val1->str, val2->str);
       default:
         return FALSE;
     }
@@ -154,6 +297,44 @@ push_bool_t push_val_equal(push_val_t *val1, push_val_t *val2) {
 }
 
 
+/* Structural hash: values that are push_val_equal have equal hashes */
+guint push_val_hash(push_val_t *val) {
+  guint i, h;
+
+  g_return_val_if_null(val, 0);
+
+  switch (val->type) {
+    case PUSH_TYPE_BOOL:
+      return val->boolean ? 1 : 0;
+    case PUSH_TYPE_CODE:
+      return push_code_hash(val->code);
+    case PUSH_TYPE_INT:
+      return (guint)val->integer;
+    case PUSH_TYPE_INSTR:
+      return g_direct_hash(val->instr);
+    case PUSH_TYPE_NAME:
+      return g_direct_hash(val->name);
+    case PUSH_TYPE_REAL:
+      /* 0.0 and -0.0 are equal */
+      return val->real == 0.0 ? 0 : g_double_hash(&val->real);
+    case PUSH_TYPE_INTVEC:
+      for (i = 0, h = val->vec->len; i < val->vec->len; i++) {
+        h = h * 31 + (guint)push_vec_ints(val->vec)[i];
+      }
+      return h;
+    case PUSH_TYPE_REALVEC:
+      for (i = 0, h = val->vec->len; i < val->vec->len; i++) {
+        h = h * 31 + (push_vec_reals(val->vec)[i] == 0.0 ? 0 : g_double_hash(&push_vec_reals(val->vec)[i]));
+      }
+      return h;
+    case PUSH_TYPE_STRING:
+      return push_str_hash(val->str);
+    default:
+      return 0;
+  }
+}
+
+
 push_val_t *push_val_make_code(push_t *push, push_val_t *val) {
   push_val_t *val_new;
 
@@ -0,0 +1,381 @@
+/* vec.c - Vectors of integers and reals
+ * NOTE: The kernels use SSE2/SSE4.1/AVX/AVX2, if the compiler targets them
+ *       (e.g. with -march=native), and plain loops otherwise. Integer
+ *       arithmetic wraps around like the SIMD instructions do.
+ *
+ * Copyright (c) 2012 Janosch Gräf <janosch.graef@gmx.net>
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include <glib.h>
+
+#if defined(__AVX__) || defined(__AVX2__)
+  #include <immintrin.h>
+#elif defined(__SSE4_1__)
+  #include <smmintrin.h>
+#elif defined(__SSE2__)
+  #include <emmintrin.h>
+#endif
+
+#include "push.h"
+
+
+/* integer registers */
+#if defined(__AVX2__)
+  #define PUSH_VEC_INT_LANES         8
+  typedef __m256i push_vec_int_reg_t;
+  #define push_vec_int_load(p)       _mm256_loadu_si256((const __m256i*)(p))
+  #define push_vec_int_store(p, r)   _mm256_storeu_si256((__m256i*)(p), r)
+  #define push_vec_int_set1(x)       _mm256_set1_epi32(x)
+  #define push_vec_int_zero()        _mm256_setzero_si256()
+  #define push_vec_int_add_reg(a, b) _mm256_add_epi32(a, b)
+  #define push_vec_int_sub_reg(a, b) _mm256_sub_epi32(a, b)
+  #define push_vec_int_mul_reg(a, b) _mm256_mullo_epi32(a, b)
+#elif defined(__SSE2__)
+  #define PUSH_VEC_INT_LANES         4
+  typedef __m128i push_vec_int_reg_t;
+  #define push_vec_int_load(p)       _mm_loadu_si128((const __m128i*)(p))
+  #define push_vec_int_store(p, r)   _mm_storeu_si128((__m128i*)(p), r)
+  #define push_vec_int_set1(x)       _mm_set1_epi32(x)
+  #define push_vec_int_zero()        _mm_setzero_si128()
+  #define push_vec_int_add_reg(a, b) _mm_add_epi32(a, b)
+  #define push_vec_int_sub_reg(a, b) _mm_sub_epi32(a, b)
+  #ifdef __SSE4_1__
+    #define push_vec_int_mul_reg(a, b) _mm_mullo_epi32(a, b)
+  #endif
+#endif
+
+/* real registers */
+#if defined(__AVX__)
+  #define PUSH_VEC_REAL_LANES         4
+  typedef __m256d push_vec_real_reg_t;
+  #define push_vec_real_load(p)       _mm256_loadu_pd(p)
+  #define push_vec_real_store(p, r)   _mm256_storeu_pd(p, r)
+  #define push_vec_real_set1(x)       _mm256_set1_pd(x)
+  #define push_vec_real_zero()        _mm256_setzero_pd()
+  #define push_vec_real_add_reg(a, b) _mm256_add_pd(a, b)
+  #define push_vec_real_sub_reg(a, b) _mm256_sub_pd(a, b)
+  #define push_vec_real_mul_reg(a, b) _mm256_mul_pd(a, b)
+#elif defined(__SSE2__)
+  #define PUSH_VEC_REAL_LANES         2
+  typedef __m128d push_vec_real_reg_t;
+  #define push_vec_real_load(p)       _mm_loadu_pd(p)
+  #define push_vec_real_store(p, r)   _mm_storeu_pd(p, r)
+  #define push_vec_real_set1(x)       _mm_set1_pd(x)
+  #define push_vec_real_zero()        _mm_setzero_pd()
+  #define push_vec_real_add_reg(a, b) _mm_add_pd(a, b)
+  #define push_vec_real_sub_reg(a, b) _mm_sub_pd(a, b)
+  #define push_vec_real_mul_reg(a, b) _mm_mul_pd(a, b)
+#endif
+
+/* wrapping integer arithmetic */
+#define WRAP_ADD(a, b) ((push_int_t)((guint32)(a) + (guint32)(b)))
+#define WRAP_SUB(a, b) ((push_int_t)((guint32)(a) - (guint32)(b)))
+#define WRAP_MUL(a, b) ((push_int_t)((guint32)(a) * (guint32)(b)))
+
+
+
+push_vec_t *push_vec_new_int(push_int_t length) {
+  push_vec_t *vec;
+
+  vec = g_array_sized_new(FALSE, TRUE, sizeof(push_int_t), length);
+  g_array_set_size(vec, length);
+
+  return vec;
+}
+
+
+push_vec_t *push_vec_new_real(push_int_t length) {
+  push_vec_t *vec;
+
+  vec = g_array_sized_new(FALSE, TRUE, sizeof(push_real_t), length);
+  g_array_set_size(vec, length);
+
+  return vec;
+}
+
+
+push_vec_t *push_vec_dup(push_vec_t *vec) {
+  g_return_val_if_null(vec, NULL);
+
+  return push_vec_slice(vec, 0, vec->len);
+}
+
+
+/* Returns new vector with the elements start, ..., end - 1 of vec */
+push_vec_t *push_vec_slice(push_vec_t *vec, push_int_t start, push_int_t end) {
+  push_vec_t *new_vec;
+  guint size;
+
+  g_return_val_if_null(vec, NULL);
+
+  start = CLAMP(start, 0, (push_int_t)vec->len);
+  end = CLAMP(end, start, (push_int_t)vec->len);
+  size = g_array_get_element_size(vec);
+
+  new_vec = g_array_sized_new(FALSE, FALSE, size, end - start);
+  g_array_append_vals(new_vec, vec->data + start * size, end - start);
+
+  return new_vec;
+}
+
+
+void push_vec_destroy(push_vec_t *vec) {
+  g_array_free(vec, TRUE);
+}
+
+
+
+/* INTEGER KERNELS */
+
+void push_vec_int_add(push_int_t *dst, const push_int_t *a, const push_int_t *b, push_int_t n) {
+  push_int_t i = 0;
+
+#ifdef PUSH_VEC_INT_LANES
+  for (; i + PUSH_VEC_INT_LANES <= n; i += PUSH_VEC_INT_LANES) {
+    push_vec_int_store(dst + i, push_vec_int_add_reg(push_vec_int_load(a + i), push_vec_int_load(b + i)));
+  }
+#endif
+  for (; i < n; i++) {
+    dst[i] = WRAP_ADD(a[i], b[i]);
+  }
+}
+
+void push_vec_int_sub(push_int_t *dst, const push_int_t *a, const push_int_t *b, push_int_t n) {
+  push_int_t i = 0;
+
+#ifdef PUSH_VEC_INT_LANES
+  for (; i + PUSH_VEC_INT_LANES <= n; i += PUSH_VEC_INT_LANES) {
+    push_vec_int_store(dst + i, push_vec_int_sub_reg(push_vec_int_load(a + i), push_vec_int_load(b + i)));
+  }
+#endif
+  for (; i < n; i++) {
+    dst[i] = WRAP_SUB(a[i], b[i]);
+  }
+}
+
+void push_vec_int_mul(push_int_t *dst, const push_int_t *a, const push_int_t *b, push_int_t n) {
+  push_int_t i = 0;
+
+#ifdef push_vec_int_mul_reg
+  for (; i + PUSH_VEC_INT_LANES <= n; i += PUSH_VEC_INT_LANES) {
+    push_vec_int_store(dst + i, push_vec_int_mul_reg(push_vec_int_load(a + i), push_vec_int_load(b + i)));
+  }
+#endif
+  for (; i < n; i++) {
+    dst[i] = WRAP_MUL(a[i], b[i]);
+  }
+}
+
+void push_vec_int_offset(push_int_t *dst, const push_int_t *a, push_int_t s, push_int_t n) {
+  push_int_t i = 0;
+#ifdef PUSH_VEC_INT_LANES
+  push_vec_int_reg_t r = push_vec_int_set1(s);
+
+  for (; i + PUSH_VEC_INT_LANES <= n; i += PUSH_VEC_INT_LANES) {
+    push_vec_int_store(dst + i, push_vec_int_add_reg(push_vec_int_load(a + i), r));
+  }
+#endif
+  for (; i < n; i++) {
+    dst[i] = WRAP_ADD(a[i], s);
+  }
+}
+
+void push_vec_int_scale(push_int_t *dst, const push_int_t *a, push_int_t s, push_int_t n) {
+  push_int_t i = 0;
+#ifdef push_vec_int_mul_reg
+  push_vec_int_reg_t r = push_vec_int_set1(s);
+
+  for (; i + PUSH_VEC_INT_LANES <= n; i += PUSH_VEC_INT_LANES) {
+    push_vec_int_store(dst + i, push_vec_int_mul_reg(push_vec_int_load(a + i), r));
+  }
+#endif
+  for (; i < n; i++) {
+    dst[i] = WRAP_MUL(a[i], s);
+  }
+}
+
+push_int_t push_vec_int_dot(const push_int_t *a, const push_int_t *b, push_int_t n) {
+  push_int_t i = 0, sum = 0;
+#ifdef push_vec_int_mul_reg
+  push_int_t lanes[PUSH_VEC_INT_LANES], j;
+  push_vec_int_reg_t acc = push_vec_int_zero();
+
+  for (; i + PUSH_VEC_INT_LANES <= n; i += PUSH_VEC_INT_LANES) {
+    acc = push_vec_int_add_reg(acc, push_vec_int_mul_reg(push_vec_int_load(a + i), push_vec_int_load(b + i)));
+  }
+
+  push_vec_int_store(lanes, acc);
+  for (j = 0; j < PUSH_VEC_INT_LANES; j++) {
+    sum = WRAP_ADD(sum, lanes[j]);
+  }
+#endif
+  for (; i < n; i++) {
+    sum = WRAP_ADD(sum, WRAP_MUL(a[i], b[i]));
+  }
+
+  return sum;
+}
+
+push_int_t push_vec_int_sum(const push_int_t *a, push_int_t n) {
+  push_int_t i = 0, sum = 0;
+#ifdef PUSH_VEC_INT_LANES
+  push_int_t lanes[PUSH_VEC_INT_LANES], j;
+  push_vec_int_reg_t acc = push_vec_int_zero();
+
+  for (; i + PUSH_VEC_INT_LANES <= n; i += PUSH_VEC_INT_LANES) {
+    acc = push_vec_int_add_reg(acc, push_vec_int_load(a + i));
+  }
+
+  push_vec_int_store(lanes, acc);
+  for (j = 0; j < PUSH_VEC_INT_LANES; j++) {
+    sum = WRAP_ADD(sum, lanes[j]);
+  }
+#endif
+  for (; i < n; i++) {
+    sum = WRAP_ADD(sum, a[i]);
+  }
+
+  return sum;
+}
+
+
+
+/* REAL KERNELS
+ * NOTE: sums are computed per lane, so they may be rounded differently than
+ *       the plain loop
+ */
+
+void push_vec_real_add(push_real_t *dst, const push_real_t *a, const push_real_t *b, push_int_t n) {
+  push_int_t i = 0;
+
+#ifdef PUSH_VEC_REAL_LANES
+  for (; i + PUSH_VEC_REAL_LANES <= n; i += PUSH_VEC_REAL_LANES) {
+    push_vec_real_store(dst + i, push_vec_real_add_reg(push_vec_real_load(a + i), push_vec_real_load(b + i)));
+  }
+#endif
+  for (; i < n; i++) {
+    dst[i] = a[i] + b[i];
+  }
+}
+
+void push_vec_real_sub(push_real_t *dst, const push_real_t *a, const push_real_t *b, push_int_t n) {
+  push_int_t i = 0;
+
+#ifdef PUSH_VEC_REAL_LANES
+  for (; i + PUSH_VEC_REAL_LANES <= n; i += PUSH_VEC_REAL_LANES) {
+    push_vec_real_store(dst + i, push_vec_real_sub_reg(push_vec_real_load(a + i), push_vec_real_load(b + i)));
+  }
+#endif
+  for (; i < n; i++) {
+    dst[i] = a[i] - b[i];
+  }
+}
+
+void push_vec_real_mul(push_real_t *dst, const push_real_t *a, const push_real_t *b, push_int_t n) {
+  push_int_t i = 0;
+
+#ifdef PUSH_VEC_REAL_LANES
+  for (; i + PUSH_VEC_REAL_LANES <= n; i += PUSH_VEC_REAL_LANES) {
+    push_vec_real_store(dst + i, push_vec_real_mul_reg(push_vec_real_load(a + i), push_vec_real_load(b + i)));
+  }
+#endif
+  for (; i < n; i++) {
+    dst[i] = a[i] * b[i];
+  }
+}
+
+void push_vec_real_offset(push_real_t *dst, const push_real_t *a, push_real_t s, push_int_t n) {
+  push_int_t i = 0;
+#ifdef PUSH_VEC_REAL_LANES
+  push_vec_real_reg_t r = push_vec_real_set1(s);
+
+  for (; i + PUSH_VEC_REAL_LANES <= n; i += PUSH_VEC_REAL_LANES) {
+    push_vec_real_store(dst + i, push_vec_real_add_reg(push_vec_real_load(a + i), r));
+  }
+#endif
+  for (; i < n; i++) {
+    dst[i] = a[i] + s;
+  }
+}
+
+void push_vec_real_scale(push_real_t *dst, const push_real_t *a, push_real_t s, push_int_t n) {
+  push_int_t i = 0;
+#ifdef PUSH_VEC_REAL_LANES
+  push_vec_real_reg_t r = push_vec_real_set1(s);
+
+  for (; i + PUSH_VEC_REAL_LANES <= n; i += PUSH_VEC_REAL_LANES) {
+    push_vec_real_store(dst + i, push_vec_real_mul_reg(push_vec_real_load(a + i), r));
+  }
+#endif
+  for (; i < n; i++) {
+    dst[i] = a[i] * s;
+  }
+}
+
+push_real_t push_vec_real_dot(const push_real_t *a, const push_real_t *b, push_int_t n) {
+  push_int_t i = 0;
+  push_real_t sum = 0.0;
+#ifdef PUSH_VEC_REAL_LANES
+  push_real_t lanes[PUSH_VEC_REAL_LANES];
+  push_vec_real_reg_t acc = push_vec_real_zero();
+  push_int_t j;
+
+  for (; i + PUSH_VEC_REAL_LANES <= n; i += PUSH_VEC_REAL_LANES) {
+    acc = push_vec_real_add_reg(acc, push_vec_real_mul_reg(push_vec_real_load(a + i), push_vec_real_load(b + i)));
+  }
+
+  push_vec_real_store(lanes, acc);
+  for (j = 0; j < PUSH_VEC_REAL_LANES; j++) {
+    sum += lanes[j];
+  }
+#endif
+  for (; i < n; i++) {
+    sum += a[i] * b[i];
+  }
+
+  return sum;
+}
+
+push_real_t push_vec_real_sum(const push_real_t *a, push_int_t n) {
+  push_int_t i = 0;
+  push_real_t sum = 0.0;
+#ifdef PUSH_VEC_REAL_LANES
+  push_real_t lanes[PUSH_VEC_REAL_LANES];
+  push_vec_real_reg_t acc = push_vec_real_zero();
+  push_int_t j;
+
+  for (; i + PUSH_VEC_REAL_LANES <= n; i += PUSH_VEC_REAL_LANES) {
+    acc = push_vec_real_add_reg(acc, push_vec_real_load(a + i));
+  }
+
+  push_vec_real_store(lanes, acc);
+  for (j = 0; j < PUSH_VEC_REAL_LANES; j++) {
+    sum += lanes[j];
+  }
+#endif
+  for (; i < n; i++) {
+    sum += a[i];
+  }
+
+  return sum;
+}
+
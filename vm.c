@@ -20,23 +20,393 @@
  * IN THE SOFTWARE.
  */
 
+#ifdef __linux__
+#define _GNU_SOURCE
+#include <sched.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sys/syscall.h>
+#include <sys/eventfd.h>
+#include <linux/futex.h>
+#endif
+
+#ifdef PUSH_USE_NUMA
+#include <numa.h>
+#endif
+
+#include <string.h>
+
 #include <glib.h>
 
 #include "push.h"
 
 
 
-static void push_vm_run_process(push_t *push, push_vm_t *vm) {
-  push_run(push, vm->max_steps);
+/* worker of the current thread, if it's a worker thread */
+static GStaticPrivate push_vm_current_worker = G_STATIC_PRIVATE_INIT;
+
+
+static void push_vm_queue(push_vm_t *vm, push_vm_process_t *process, push_bool_t preempted);
+
+
+/* sleeps while *value is still expected (or until woken up spuriously)
+ * NOTE: Callers check *value again. On Linux this is a futex, so there's no
+ *       lock on either side.
+ */
+static void push_vm_sleep(push_vm_t *vm, gint *value, gint expected) {
+#ifdef __linux__
+  syscall(SYS_futex, value, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+#else
+  g_mutex_lock(vm->mutex);
+  if (g_atomic_int_get(value) == expected) {
+    g_cond_wait(vm->wait_cond, vm->mutex);
+  }
+  g_mutex_unlock(vm->mutex);
+#endif
+}
+
 
+/* wakes up all threads sleeping on value */
+static void push_vm_wake(push_vm_t *vm, gint *value) {
+#ifdef __linux__
+  syscall(SYS_futex, value, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#else
   g_mutex_lock(vm->mutex);
-  vm->processes = g_list_remove(vm->processes, push);  
-  g_cond_signal(vm->wait_cond);
+  g_cond_broadcast(vm->wait_cond);
   g_mutex_unlock(vm->mutex);
+#endif
+}
+
+
+/* CPU time the worker's thread used (usec)
+ * NOTE: Without thread CPU clocks this is wall-clock time, which only
+ *       counts while the process runs, too.
+ */
+static gint64 push_vm_worker_cpu_time(push_vm_worker_t *worker) {
+#ifdef __linux__
+  struct timespec ts;
+
+  if (clock_gettime(worker->cpu_clock, &ts) == 0) {
+    return (gint64)ts.tv_sec * G_USEC_PER_SEC + ts.tv_nsec / 1000;
+  }
+#endif
+
+  return g_get_monotonic_time();
+}
+
+
+/* interrupts process that ran out of time
+ * NOTE: other interrupts (e.g. a kill) aren't replaced, only a yield is
+ */
+static void push_vm_expire(push_t *push, push_int_t interrupt_flag) {
+  if (!g_atomic_int_compare_and_exchange(&push->interrupt_flag, 0, interrupt_flag)) {
+    g_atomic_int_compare_and_exchange(&push->interrupt_flag, PUSH_VM_INTERRUPT_YIELD, interrupt_flag);
+  }
+}
+
+
+/* whether process has a time budget */
+#define push_vm_has_budget(process)  ((process)->deadline > 0 || (process)->max_cpu_time > 0)
+
+
+/* checks the time budget of a process, that has used cpu_time so far */
+static void push_vm_check_budget(push_vm_process_t *process, gint64 now, gint64 cpu_time) {
+  if (process->deadline > 0 && now >= process->deadline) {
+    push_vm_expire(process->push, PUSH_VM_INTERRUPT_WALL_TIME);
+  }
+  else if (process->max_cpu_time > 0 && cpu_time >= process->max_cpu_time) {
+    push_vm_expire(process->push, PUSH_VM_INTERRUPT_CPU_TIME);
+  }
+}
+
+
+/* adds value to histogram */
+static void push_vm_histogram_add(push_vm_histogram_t *histogram, gint64 value) {
+  gint64 v;
+  guint i;
+
+  value = MAX(value, 0);
+
+  for (i = 0, v = value; v > 0 && i < PUSH_VM_HISTOGRAM_BUCKETS - 1; i++, v >>= 1);
+  histogram->buckets[i]++;
+
+  histogram->min = histogram->count == 0 ? value : MIN(histogram->min, value);
+  histogram->max = histogram->count == 0 ? value : MAX(histogram->max, value);
+  histogram->count++;
+  histogram->sum += value;
+}
+
+
+/* adds values of histogram2 to histogram1 */
+static void push_vm_histogram_merge(push_vm_histogram_t *histogram1, push_vm_histogram_t *histogram2) {
+  guint i;
+
+  if (histogram2->count == 0) {
+    return;
+  }
+
+  for (i = 0; i < PUSH_VM_HISTOGRAM_BUCKETS; i++) {
+    histogram1->buckets[i] += histogram2->buckets[i];
+  }
+
+  histogram1->min = histogram1->count == 0 ? histogram2->min : MIN(histogram1->min, histogram2->min);
+  histogram1->max = histogram1->count == 0 ? histogram2->max : MAX(histogram1->max, histogram2->max);
+  histogram1->count += histogram2->count;
+  histogram1->sum += histogram2->sum;
+}
+
+
+/* adds process that is done to the statistics of the worker */
+static void push_vm_record_process(push_vm_worker_t *worker, push_vm_process_t *process) {
+  g_mutex_lock(worker->mutex);
+  worker->stats.processes++;
+  push_vm_histogram_add(&worker->stats.wait_time, process->wait_time);
+  push_vm_histogram_add(&worker->stats.run_time, process->run_time);
+  push_vm_histogram_add(&worker->stats.steps, process->steps);
+  push_vm_histogram_add(&worker->stats.speed, (gint64)process->steps * G_USEC_PER_SEC / MAX(process->run_time, 1));
+  g_mutex_unlock(worker->mutex);
+}
+
+
+/* returns worker owning pool, or NULL if it isn't one of the VM's pools */
+static push_vm_worker_t *push_vm_pool_worker(push_vm_t *vm, push_pool_t *pool) {
+  push_int_t i;
 
-  if (vm->done_callback != NULL) {
+  for (i = 0; pool != NULL && i < vm->num_workers; i++) {
+    if (vm->workers[i].pool == pool) {
+      return &vm->workers[i];
+    }
+  }
+
+  return NULL;
+}
+
+
+/* puts interpreter back into its pool, if it was checked out from the VM */
+static void push_vm_checkin(push_vm_t *vm, push_t *push) {
+  if (push_vm_pool_worker(vm, push->pool) != NULL) {
+    push_pool_put(push->pool, push);
+  }
+}
+
+
+/* process is done: call done callback, complete future and update counters */
+static void push_vm_finish_process(push_vm_t *vm, push_vm_process_t *process, push_bool_t run) {
+  push_t *push = process->push;
+  push_vm_future_t *future = process->future;
+  push_vm_worker_t *worker;
+  push_int_t interrupt_flag = push->interrupt_flag;
+
+  /* NOTE: dropped processes aren't counted (they're dropped by other threads, too) */
+  worker = (push_vm_worker_t*)g_static_private_get(&push_vm_current_worker);
+  if (run && worker != NULL && worker->vm == vm) {
+    push_vm_record_process(worker, process);
+  }
+
+  /* NOTE: the callback is done before push_vm_wait returns */
+  if (run && vm->done_callback != NULL) {
     vm->done_callback(vm, push);
   }
+
+  push_vm_checkin(vm, push);
+
+  if (future != NULL) {
+    future->steps = process->steps;
+    future->interrupt_flag = interrupt_flag;
+    future->wait_time = process->wait_time;
+    future->run_time = process->run_time;
+    g_atomic_int_set(&future->done, TRUE);
+
+    if (future->completions != NULL) {
+      g_async_queue_push(future->completions, push_vm_future_ref(future));
+    }
+
+    /* NOTE: waiters count themselves before they check the future */
+    if (g_atomic_int_get(&vm->num_waiters) > 0) {
+      push_vm_wake(vm, &future->done);
+    }
+
+    push_vm_future_unref(future);
+  }
+
+  g_slice_free(push_vm_process_t, process);
+
+#ifdef __linux__
+  if (vm->eventfd >= 0) {
+    eventfd_write(vm->eventfd, 1);
+  }
+#endif
+
+  /* only the last process wakes up waiting threads */
+  if (g_atomic_int_dec_and_test(&vm->num_processes) && g_atomic_int_get(&vm->num_waiters) > 0) {
+    push_vm_wake(vm, &vm->num_processes);
+  }
+}
+
+
+/* parks process in the wait queue until it's signalled
+ * NOTE: The process counts as waiting before the signals are checked, and
+ *       signals are counted before waiting processes are checked, so a
+ *       signal can't get lost in between.
+ */
+static void push_vm_park_process(push_vm_t *vm, push_vm_process_t *process, push_vm_waitq_t *waitq, gint signals) {
+  push_bool_t signalled;
+
+  g_mutex_lock(waitq->mutex);
+
+  /* make sure the VM knows the wait queue */
+  if (g_slist_find(waitq->vms, vm) == NULL) {
+    waitq->vms = g_slist_prepend(waitq->vms, vm);
+
+    g_mutex_lock(vm->mutex);
+    vm->waitqs = g_slist_prepend(vm->waitqs, waitq);
+    g_mutex_unlock(vm->mutex);
+  }
+
+  g_atomic_int_inc(&waitq->num_waiting);
+  signalled = g_atomic_int_get(&waitq->signals) != signals;
+  if (!signalled) {
+    process->waitq = waitq;
+    g_queue_push_tail(waitq->waiting, process);
+    g_atomic_int_inc(&vm->num_parked);
+  }
+  else {
+    g_atomic_int_add(&waitq->num_waiting, -1);
+  }
+
+  g_mutex_unlock(waitq->mutex);
+
+  if (signalled) {
+    push_vm_queue(vm, process, TRUE);
+  }
+}
+
+
+/* takes parked processes of the VM out of their wait queues: all of them,
+ * or if now > 0, those that ran out of time by now
+ */
+static void push_vm_take_parked(push_vm_t *vm, GQueue *taken, gint64 now) {
+  push_vm_waitq_t *waitq;
+  push_vm_process_t *process;
+  GSList *waitqs, *link;
+  GList *link2, *next_link;
+
+  /* NOTE: wait queues outlive the VM, and their mutex is taken first */
+  g_mutex_lock(vm->mutex);
+  waitqs = g_slist_copy(vm->waitqs);
+  g_mutex_unlock(vm->mutex);
+
+  for (link = waitqs; link != NULL; link = link->next) {
+    waitq = (push_vm_waitq_t*)link->data;
+
+    g_mutex_lock(waitq->mutex);
+    for (link2 = waitq->waiting->head; link2 != NULL; link2 = next_link) {
+      next_link = link2->next;
+      process = (push_vm_process_t*)link2->data;
+
+      if (process->vm == vm) {
+        if (now > 0) {
+          push_vm_check_budget(process, now, process->cpu_time);
+        }
+
+        if (now <= 0 || process->push->interrupt_flag < 0) {
+          g_queue_unlink(waitq->waiting, link2);
+          g_queue_push_tail_link(taken, link2);
+          g_atomic_int_add(&waitq->num_waiting, -1);
+          g_atomic_int_add(&vm->num_parked, -1);
+          process->waitq = NULL;
+        }
+      }
+    }
+    g_mutex_unlock(waitq->mutex);
+  }
+
+  g_slist_free(waitqs);
+}
+
+
+/* runs process for a time slice, or until it's done */
+static void push_vm_run_process(push_vm_worker_t *worker, push_vm_process_t *process) {
+  push_vm_t *vm = worker->vm;
+  push_t *push = process->push;
+  push_vm_waitq_t *park;
+  push_int_t quantum, slice, steps;
+  gint64 start_time, end_time, cpu_time;
+
+  quantum = g_atomic_int_get(&vm->quantum);
+  slice = vm->max_steps > 0 ? vm->max_steps - process->steps : 0;
+  if (quantum > 0 && (slice <= 0 || quantum * process->priority < slice)) {
+    slice = quantum * process->priority;
+  }
+
+  start_time = g_get_monotonic_time();
+  process->wait_time += start_time - process->queued_time;
+
+  /* NOTE: a process killed or out of time while it was queued isn't run anymore */
+  if (push_vm_has_budget(process)) {
+    push_vm_check_budget(process, start_time, process->cpu_time);
+  }
+  if (push->interrupt_flag < 0) {
+    push_vm_finish_process(vm, process, TRUE);
+    return;
+  }
+
+  cpu_time = process->max_cpu_time > 0 ? push_vm_worker_cpu_time(worker) : 0;
+
+  g_mutex_lock(worker->mutex);
+  worker->current = process;
+  worker->slice_cpu_time = cpu_time;
+  g_mutex_unlock(worker->mutex);
+
+  steps = push_resume(push, slice);
+  process->steps += steps;
+
+  end_time = g_get_monotonic_time();
+  process->run_time += end_time - start_time;
+
+  g_mutex_lock(worker->mutex);
+  worker->current = NULL;
+  worker->stats.slices++;
+  worker->stats.busy_time += end_time - start_time;
+  g_mutex_unlock(worker->mutex);
+
+  /* NOTE: the watchdog only looks every now and then, so check the budget after each slice, too */
+  if (push_vm_has_budget(process)) {
+    if (process->max_cpu_time > 0) {
+      process->cpu_time += push_vm_worker_cpu_time(worker) - cpu_time;
+    }
+    push_vm_check_budget(process, end_time, process->cpu_time);
+  }
+
+  park = worker->park;
+  worker->park = NULL;
+
+  /* NOTE: a kill raised meanwhile replaces the yield and ends the process */
+  if (g_atomic_int_compare_and_exchange(&push->interrupt_flag, PUSH_VM_INTERRUPT_YIELD, 0)) {
+    /* process isn't done, it waits or lets others run */
+    if (park != NULL) {
+      push_vm_park_process(vm, process, park, worker->park_signals);
+    }
+    else {
+      push_vm_queue(vm, process, TRUE);
+    }
+    return;
+  }
+
+  if (slice > 0 && steps == slice && push->interrupt_flag == 0 && (vm->max_steps <= 0 || process->steps < vm->max_steps)) {
+    push_vm_queue(vm, process, TRUE);
+    return;
+  }
+
+  push_vm_finish_process(vm, process, TRUE);
+}
+
+
+/* removes process without running it */
+static void push_vm_drop_process(push_vm_process_t *process, push_vm_t *vm) {
+  push_vm_finish_process(vm, process, FALSE);
 }
 
 
@@ -45,25 +415,399 @@ static void push_vm_destroy_process(push_t *push, push_vm_t *vm) {
 }
 
 
+/* returns worker of the current thread, or the next worker (round robin) */
+static push_vm_worker_t *push_vm_get_worker(push_vm_t *vm) {
+  push_vm_worker_t *worker;
+
+  worker = (push_vm_worker_t*)g_static_private_get(&push_vm_current_worker);
+  if (worker == NULL || worker->vm != vm) {
+    worker = &vm->workers[(guint)g_atomic_int_exchange_and_add(&vm->next_worker, 1) % vm->num_workers];
+  }
+
+  return worker;
+}
+
+
+/* queues process at a worker and wakes up an idle worker */
+static void push_vm_queue(push_vm_t *vm, push_vm_process_t *process, push_bool_t preempted) {
+  push_vm_worker_t *worker;
+
+  /* processes of checked out interpreters go to the worker owning their
+   * pool, processes submitted by a worker stay with it, others are
+   * distributed
+   */
+  worker = push_vm_pool_worker(vm, process->push->pool);
+  if (worker == NULL) {
+    worker = push_vm_get_worker(vm);
+  }
+
+  process->queued_time = g_get_monotonic_time();
+
+  g_mutex_lock(worker->mutex);
+  g_queue_push_tail(preempted ? worker->queue : worker->fresh, process);
+  g_mutex_unlock(worker->mutex);
+
+  /* NOTE: idle workers count themselves before they check num_queued, so
+   *       either they see this process or we see them
+   */
+  g_atomic_int_inc(&vm->num_queued);
+  if (g_atomic_int_get(&vm->num_idle) > 0) {
+    g_mutex_lock(vm->idle_mutex);
+    g_cond_signal(vm->idle_cond);
+    g_mutex_unlock(vm->idle_mutex);
+  }
+}
+
+
+/* takes next process from the worker's own queues (worker->mutex must be held)
+ * NOTE: New processes go first, so they don't wait for long running ones,
+ *       but only PUSH_VM_MAX_OVERTAKE of them in a row while a preempted
+ *       process is waiting.
+ */
+static push_vm_process_t *push_vm_worker_pop(push_vm_worker_t *worker) {
+  if (!g_queue_is_empty(worker->fresh) && (g_queue_is_empty(worker->queue) || worker->overtaken < PUSH_VM_MAX_OVERTAKE)) {
+    worker->overtaken = g_queue_is_empty(worker->queue) ? 0 : worker->overtaken + 1;
+    return (push_vm_process_t*)g_queue_pop_head(worker->fresh);
+  }
+
+  worker->overtaken = 0;
+  return (push_vm_process_t*)g_queue_pop_head(worker->queue);
+}
+
+
+/* takes a process from own queues or steals one from another worker */
+static push_vm_process_t *push_vm_worker_take(push_vm_worker_t *worker) {
+  push_vm_t *vm = worker->vm;
+  push_vm_worker_t *victim;
+  push_vm_process_t *process;
+  push_bool_t stolen = FALSE;
+  push_int_t i;
+
+  if (g_atomic_int_get(&vm->num_queued) == 0) {
+    return NULL;
+  }
+
+  g_mutex_lock(worker->mutex);
+  process = push_vm_worker_pop(worker);
+  g_mutex_unlock(worker->mutex);
+
+  for (i = 1; process == NULL && i < vm->num_workers; i++) {
+    victim = &vm->workers[(worker->index + i) % vm->num_workers];
+
+    /* NOTE: Don't wait for a busy queue, there are others to try. The
+     *       oldest new process is stolen first, so they still start in
+     *       order of arrival.
+     */
+    if (g_mutex_trylock(victim->mutex)) {
+      process = (push_vm_process_t*)g_queue_pop_head(victim->fresh);
+      if (process == NULL) {
+        process = (push_vm_process_t*)g_queue_pop_tail(victim->queue);
+      }
+      g_mutex_unlock(victim->mutex);
+      stolen = process != NULL;
+    }
+  }
+
+  if (process != NULL) {
+    g_atomic_int_add(&vm->num_queued, -1);
+  }
+  if (stolen) {
+    g_atomic_int_inc(&worker->steals);
+  }
+
+  return process;
+}
+
+
+/* assigns CPUs and NUMA nodes to workers */
+static void push_vm_place_workers(push_vm_t *vm) {
+  push_int_t i, num_cpus = 0;
+#ifdef __linux__
+  cpu_set_t allowed;
+  push_int_t cpus[CPU_SETSIZE];
+#endif
+#ifdef PUSH_USE_NUMA
+  push_int_t num_nodes = 0;
+  push_int_t nodes[CPU_SETSIZE];
+  struct bitmask *node_cpus;
+#endif
+
+  for (i = 0; i < vm->num_workers; i++) {
+    vm->workers[i].cpu = -1;
+    vm->workers[i].node = -1;
+  }
+
+  if (vm->placement == PUSH_VM_PLACEMENT_NONE) {
+    return;
+  }
+
+#ifdef PUSH_USE_NUMA
+  if (vm->placement == PUSH_VM_PLACEMENT_NUMA && numa_available() >= 0) {
+    /* nodes that have CPUs, workers are dealt to them in turn */
+    node_cpus = numa_allocate_cpumask();
+    for (i = 0; i <= numa_max_node() && num_nodes < CPU_SETSIZE; i++) {
+      if (numa_node_to_cpus(i, node_cpus) == 0 && numa_bitmask_weight(node_cpus) > 0) {
+        nodes[num_nodes++] = i;
+      }
+    }
+    numa_free_cpumask(node_cpus);
+
+    if (num_nodes > 0) {
+      for (i = 0; i < vm->num_workers; i++) {
+        vm->workers[i].node = nodes[i % num_nodes];
+      }
+      return;
+    }
+  }
+#endif
+
+#ifdef __linux__
+  /* CPUs this process may run on */
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+    for (i = 0; i < CPU_SETSIZE; i++) {
+      if (CPU_ISSET(i, &allowed)) {
+        cpus[num_cpus++] = i;
+      }
+    }
+  }
+
+  for (i = 0; num_cpus > 0 && i < vm->num_workers; i++) {
+    vm->workers[i].cpu = cpus[i % num_cpus];
+  }
+#endif
+}
+
+
+/* binds current thread to the worker's CPU or NUMA node */
+static void push_vm_bind_worker(push_vm_worker_t *worker) {
+#ifdef __linux__
+  cpu_set_t set;
+
+  if (worker->cpu >= 0) {
+    CPU_ZERO(&set);
+    CPU_SET(worker->cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+      g_warning("Can't pin VM worker %d to CPU %d", worker->index, worker->cpu);
+    }
+  }
+#endif
+
+#ifdef PUSH_USE_NUMA
+  if (worker->node >= 0) {
+    /* NOTE: memory is allocated on the node of the allocating thread, so
+     *       values and stacks of the worker's processes are node-local
+     */
+    if (numa_run_on_node(worker->node) != 0) {
+      g_warning("Can't run VM worker %d on NUMA node %d", worker->index, worker->node);
+    }
+    numa_set_localalloc();
+  }
+#endif
+}
+
+
+static gpointer push_vm_worker_main(push_vm_worker_t *worker) {
+  push_vm_t *vm = worker->vm;
+  push_vm_process_t *process;
+  push_bool_t quit = FALSE;
+
+  g_static_private_set(&push_vm_current_worker, worker, NULL);
+  push_vm_bind_worker(worker);
+
+#ifdef __linux__
+  /* NOTE: the watchdog reads the CPU time of this thread */
+  if (pthread_getcpuclockid(pthread_self(), &worker->cpu_clock) != 0) {
+    worker->cpu_clock = CLOCK_MONOTONIC;
+  }
+#endif
+
+  while (!quit) {
+    process = push_vm_worker_take(worker);
+
+    if (process != NULL) {
+      if (g_atomic_int_get(&vm->state) == PUSH_VM_STATE_DROP) {
+        push_vm_drop_process(process, vm);
+      }
+      else {
+        push_vm_run_process(worker, process);
+      }
+    }
+    else {
+      /* NOTE: the pool is filled by this thread, so that its interpreters
+       *       are allocated on the worker's NUMA node
+       */
+      if (worker->pool != NULL) {
+        push_pool_fill(worker->pool, PUSH_VM_POOL_FILL);
+      }
+
+      /* wait for processes */
+      g_mutex_lock(vm->idle_mutex);
+      g_atomic_int_inc(&vm->num_idle);
+      while (g_atomic_int_get(&vm->num_queued) == 0 && vm->state == PUSH_VM_STATE_RUNNING && !worker->fill_pool) {
+        g_cond_wait(vm->idle_cond, vm->idle_mutex);
+      }
+      g_atomic_int_add(&vm->num_idle, -1);
+      worker->fill_pool = FALSE;
+      quit = vm->state != PUSH_VM_STATE_RUNNING && g_atomic_int_get(&vm->num_queued) == 0;
+      g_mutex_unlock(vm->idle_mutex);
+    }
+  }
+
+  g_static_private_set(&push_vm_current_worker, NULL, NULL);
+
+  return NULL;
+}
+
+
+/* interrupts processes that ran out of time, until the VM is destroyed */
+static gpointer push_vm_watchdog_main(push_vm_t *vm) {
+  GQueue expired = G_QUEUE_INIT;
+  push_vm_worker_t *worker;
+  push_vm_process_t *process;
+  gint64 now;
+  push_int_t i;
+
+  while (!g_atomic_int_get(&vm->watchdog_quit)) {
+    g_usleep(PUSH_VM_WATCHDOG_INTERVAL);
+    now = g_get_monotonic_time();
+
+    /* running processes */
+    for (i = 0; i < vm->num_workers; i++) {
+      worker = &vm->workers[i];
+
+      g_mutex_lock(worker->mutex);
+      process = worker->current;
+      if (process != NULL && push_vm_has_budget(process)) {
+        push_vm_check_budget(process, now, process->max_cpu_time > 0 ? process->cpu_time + push_vm_worker_cpu_time(worker) - worker->slice_cpu_time : 0);
+      }
+      g_mutex_unlock(worker->mutex);
+    }
+
+    /* waiting processes must run to end (see push_vm_run_process) */
+    if (g_atomic_int_get(&vm->num_parked) > 0) {
+      push_vm_take_parked(vm, &expired, now);
+
+      while ((process = (push_vm_process_t*)g_queue_pop_head(&expired)) != NULL) {
+        push_vm_queue(vm, process, TRUE);
+      }
+    }
+  }
+
+  return NULL;
+}
+
+
+/* creates a process that isn't queued yet
+ * NOTE: The caller counts the process in num_processes. Times are in
+ *       microseconds, or 0 for no limit.
+ */
+static push_vm_process_t *push_vm_new_process(push_vm_t *vm, push_t *push, push_int_t priority, gint64 wall_time, gint64 cpu_time, push_vm_future_t *future) {
+  push_vm_process_t *process;
+
+  process = g_slice_new(push_vm_process_t);
+  process->vm = vm;
+  process->push = push;
+  process->priority = priority;
+  process->steps = 0;
+  process->future = future;
+  process->waitq = NULL;
+  process->deadline = wall_time > 0 ? g_get_monotonic_time() + wall_time : 0;
+  process->max_cpu_time = cpu_time > 0 ? cpu_time : 0;
+  process->cpu_time = 0;
+  process->queued_time = g_get_monotonic_time();
+  process->wait_time = 0;
+  process->run_time = 0;
+
+  push->interrupt_flag = 0;
+
+  /* start watchdog with the first process with a budget */
+  if ((wall_time > 0 || cpu_time > 0) && g_atomic_pointer_get(&vm->watchdog) == NULL) {
+    g_mutex_lock(vm->mutex);
+    if (vm->watchdog == NULL) {
+      vm->watchdog = g_thread_create((GThreadFunc)push_vm_watchdog_main, vm, TRUE, NULL);
+    }
+    g_mutex_unlock(vm->mutex);
+  }
+
+  return process;
+}
+
+
 push_vm_t *push_vm_new(push_int_t num_threads, push_int_t max_steps, push_vm_done_callback_t done_callback) {
+  return push_vm_new_full(num_threads, max_steps, done_callback, PUSH_VM_PLACEMENT_NONE);
+}
+
+
+push_vm_t *push_vm_new_full(push_int_t num_threads, push_int_t max_steps, push_vm_done_callback_t done_callback, push_int_t placement) {
   push_vm_t *vm;
+  push_vm_worker_t *worker;
+  push_int_t i;
 
   /* initialize threading (if not yet initialized) */
   g_thread_init(NULL);
 
   vm = g_slice_new(push_vm_t);
 
-  vm->processes = NULL;
+  vm->num_processes = 0;
+  vm->num_parked = 0;
+  vm->waitqs = NULL;
+  vm->num_waiters = 0;
+  vm->eventfd = -1;
   vm->max_steps = max_steps;
+  vm->quantum = 0;
+  vm->budget = g_slice_new0(push_vm_budget_t);
+  vm->old_budgets = NULL;
+  vm->watchdog = NULL;
+  vm->watchdog_quit = FALSE;
+  vm->placement = placement;
   vm->done_callback = done_callback;
   vm->mutex = g_mutex_new();
   vm->wait_cond = g_cond_new();
 
-  /* initialize thread pool */
-  vm->threads = g_thread_pool_new((GFunc)push_vm_run_process, vm, num_threads, TRUE, NULL);
-  if (vm->threads == NULL) {
-    g_slice_free(push_vm_t, vm);
-    return NULL;
+  /* initialize workers
+   * NOTE: without a limit, there's one worker per processor
+   */
+  vm->num_workers = num_threads > 0 ? num_threads : g_get_num_processors();
+  vm->workers = g_new(push_vm_worker_t, vm->num_workers);
+  vm->next_worker = 0;
+  vm->num_queued = 0;
+  vm->num_idle = 0;
+  vm->state = PUSH_VM_STATE_RUNNING;
+  vm->idle_mutex = g_mutex_new();
+  vm->idle_cond = g_cond_new();
+
+  for (i = 0; i < vm->num_workers; i++) {
+    worker = &vm->workers[i];
+    worker->vm = vm;
+    worker->index = i;
+    worker->fresh = g_queue_new();
+    worker->queue = g_queue_new();
+    worker->overtaken = 0;
+    worker->mutex = g_mutex_new();
+    worker->pool = NULL;
+    worker->fill_pool = FALSE;
+    worker->current = NULL;
+    worker->park = NULL;
+    memset(&worker->stats, 0, sizeof(push_vm_stats_t));
+    worker->steals = 0;
+    worker->stats_time = g_get_monotonic_time();
+  }
+  push_vm_place_workers(vm);
+
+  for (i = 0; i < vm->num_workers; i++) {
+    worker = &vm->workers[i];
+    worker->thread = g_thread_create((GThreadFunc)push_vm_worker_main, worker, TRUE, NULL);
+    if (worker->thread == NULL) {
+      /* stop workers that were started */
+      for (; i < vm->num_workers; i++) {
+        g_queue_free(vm->workers[i].fresh);
+        g_queue_free(vm->workers[i].queue);
+        g_mutex_free(vm->workers[i].mutex);
+      }
+      vm->num_workers = worker->index;
+      push_vm_destroy(vm, TRUE);
+      return NULL;
+    }
   }
 
   return vm;
@@ -71,40 +815,216 @@ push_vm_t *push_vm_new(push_int_t num_threads, push_int_t max_steps, push_vm_don
 
 
 void push_vm_destroy(push_vm_t *vm, push_bool_t kill_all) {
+  GQueue parked = G_QUEUE_INIT;
+  push_vm_worker_t *worker;
+  push_vm_process_t *process;
+  push_vm_waitq_t *waitq;
+  GSList *link;
+  push_int_t i;
+
   g_return_if_null(vm);
 
   if (kill_all) {
     push_vm_kill_all(vm);
   }
 
-  g_thread_pool_free(vm->threads, kill_all, TRUE);
+  /* stop workers */
+  g_mutex_lock(vm->idle_mutex);
+  g_atomic_int_set(&vm->state, kill_all ? PUSH_VM_STATE_DROP : PUSH_VM_STATE_FINISH);
+  g_cond_broadcast(vm->idle_cond);
+  g_mutex_unlock(vm->idle_mutex);
+
+  for (i = 0; i < vm->num_workers; i++) {
+    g_thread_join(vm->workers[i].thread);
+  }
+
+  if (vm->watchdog != NULL) {
+    g_atomic_int_set(&vm->watchdog_quit, TRUE);
+    g_thread_join(vm->watchdog);
+  }
+
+  /* NOTE: processes still waiting can't be run anymore */
+  push_vm_take_parked(vm, &parked, 0);
+  while ((process = (push_vm_process_t*)g_queue_pop_head(&parked)) != NULL) {
+    push_vm_drop_process(process, vm);
+  }
+
+  /* wait queues mustn't know this VM anymore */
+  for (link = vm->waitqs; link != NULL; link = link->next) {
+    waitq = (push_vm_waitq_t*)link->data;
+    g_mutex_lock(waitq->mutex);
+    waitq->vms = g_slist_remove(waitq->vms, vm);
+    g_mutex_unlock(waitq->mutex);
+  }
+  g_slist_free(vm->waitqs);
+
+  for (i = 0; i < vm->num_workers; i++) {
+    worker = &vm->workers[i];
+
+    /* NOTE: the watchdog may have queued expired processes after the workers quit */
+    while ((process = (push_vm_process_t*)g_queue_pop_head(worker->fresh)) != NULL) {
+      push_vm_drop_process(process, vm);
+    }
+    while ((process = (push_vm_process_t*)g_queue_pop_head(worker->queue)) != NULL) {
+      push_vm_drop_process(process, vm);
+    }
+  }
+
+  /* NOTE: only after all processes are dropped, since dropping one puts its
+   *       interpreter back into the pool it was taken from
+   */
+  for (i = 0; i < vm->num_workers; i++) {
+    worker = &vm->workers[i];
+
+    g_queue_free(worker->fresh);
+    g_queue_free(worker->queue);
+    g_mutex_free(worker->mutex);
+    if (worker->pool != NULL) {
+      push_pool_destroy(worker->pool);
+    }
+  }
+  g_free(vm->workers);
+
+  g_slice_free(push_vm_budget_t, vm->budget);
+  for (link = vm->old_budgets; link != NULL; link = link->next) {
+    g_slice_free(push_vm_budget_t, link->data);
+  }
+  g_slist_free(vm->old_budgets);
+
+  g_mutex_free(vm->idle_mutex);
+  g_cond_free(vm->idle_cond);
   g_mutex_free(vm->mutex);
   g_cond_free(vm->wait_cond);
 
+#ifdef __linux__
+  if (vm->eventfd >= 0) {
+    close(vm->eventfd);
+  }
+#endif
+
   g_slice_free(push_vm_t, vm);
 }
 
 
 void push_vm_run(push_vm_t *vm, push_t *push) {
+  push_vm_run_priority(vm, push, PUSH_VM_PRIORITY_DEFAULT);
+}
+
+
+/* Runs process with priority
+ * NOTE: With time slicing (see push_vm_set_quantum), a process gets priority
+ *       quanta per time slice. Otherwise priorities don't matter.
+ */
+void push_vm_run_priority(push_vm_t *vm, push_t *push, push_int_t priority) {
+  push_vm_budget_t *budget;
+
   g_return_if_null(vm);
 
-  g_mutex_lock(vm->mutex);
-  vm->processes = g_list_prepend(vm->processes, push);
-  g_thread_pool_push(vm->threads, push, NULL);
-  g_mutex_unlock(vm->mutex);
+  budget = (push_vm_budget_t*)g_atomic_pointer_get(&vm->budget);
+  push_vm_run_budget(vm, push, priority, budget->wall_time, budget->cpu_time);
 }
 
 
-push_int_t push_vm_num_processes(push_vm_t *vm) {
-  push_int_t num;
+/* Runs process with a time budget
+ * NOTE: wall_time counts from now, cpu_time only while the process runs
+ *       (both in microseconds, or 0 for no limit). A process out of time is
+ *       interrupted with PUSH_VM_INTERRUPT_WALL_TIME or
+ *       PUSH_VM_INTERRUPT_CPU_TIME, which the done callback can check.
+ *       Budgets are checked every PUSH_VM_WATCHDOG_INTERVAL and after each
+ *       time slice.
+ */
+void push_vm_run_budget(push_vm_t *vm, push_t *push, push_int_t priority, gint64 wall_time, gint64 cpu_time) {
+  push_vm_process_t *process;
 
-  g_return_val_if_null(vm, 0);
+  g_return_if_null(vm);
+  g_return_if_null(push);
+  g_return_if_fail(priority > 0);
+
+  process = push_vm_new_process(vm, push, priority, wall_time, cpu_time, NULL);
+  g_atomic_int_inc(&vm->num_processes);
+
+  push_vm_queue(vm, process, FALSE);
+}
+
+
+/* Sets steps per quantum, or 0 to run processes to completion
+ * NOTE: Workers round robin their processes in time slices, so that
+ *       short processes don't wait for long running ones.
+ */
+void push_vm_set_quantum(push_vm_t *vm, push_int_t quantum) {
+  g_return_if_null(vm);
+  g_return_if_fail(quantum >= 0);
+
+  g_atomic_int_set(&vm->quantum, quantum);
+}
+
+
+/* Sets the time budget of processes that are started afterwards (see push_vm_run_budget) */
+void push_vm_set_budget(push_vm_t *vm, gint64 wall_time, gint64 cpu_time) {
+  push_vm_budget_t *budget;
 
+  g_return_if_null(vm);
+  g_return_if_fail(wall_time >= 0 && cpu_time >= 0);
+
+  budget = g_slice_new(push_vm_budget_t);
+  budget->wall_time = wall_time;
+  budget->cpu_time = cpu_time;
+
+  /* NOTE: submitting threads may still read the old budget, so it's only
+   *       freed with the VM
+   */
   g_mutex_lock(vm->mutex);
-  num = g_list_length(vm->processes);
+  vm->old_budgets = g_slist_prepend(vm->old_budgets, vm->budget);
+  g_atomic_pointer_set(&vm->budget, budget);
   g_mutex_unlock(vm->mutex);
+}
 
-  return num;
+
+/* Sets template for interpreters checked out from the VM
+ * NOTE: Each worker gets its own pool of interpreters, which it fills up to
+ *       PUSH_VM_POOL_FILL interpreters whenever it's idle. So with NUMA
+ *       placement they're node-local, except for those checked out while
+ *       the pool is empty, which are created by the calling thread.
+ */
+void push_vm_set_template(push_vm_t *vm, push_template_t *template) {
+  push_int_t i;
+
+  g_return_if_null(vm);
+  g_return_if_null(template);
+  g_return_if_fail(vm->workers[0].pool == NULL);
+
+  g_mutex_lock(vm->idle_mutex);
+  for (i = 0; i < vm->num_workers; i++) {
+    vm->workers[i].pool = push_pool_new(template, 0);
+    vm->workers[i].fill_pool = TRUE;
+  }
+  g_cond_broadcast(vm->idle_cond);
+  g_mutex_unlock(vm->idle_mutex);
+}
+
+
+/* Returns interpreter from the pool of the current worker (see
+ * push_vm_set_template)
+ * NOTE: Its process is queued at that worker. When the process is done, the
+ *       interpreter is reset and put back after the done callback. Results
+ *       must be taken in the callback.
+ */
+push_t *push_vm_checkout(push_vm_t *vm) {
+  push_vm_worker_t *worker;
+
+  g_return_val_if_null(vm, NULL);
+  g_return_val_if_fail(vm->workers[0].pool != NULL, NULL);
+
+  worker = push_vm_get_worker(vm);
+
+  return push_pool_get(worker->pool);
+}
+
+
+push_int_t push_vm_num_processes(push_vm_t *vm) {
+  g_return_val_if_null(vm, 0);
+
+  return g_atomic_int_get(&vm->num_processes);
 }
 
 
@@ -113,24 +1033,47 @@ push_int_t push_vm_num_queued(push_vm_t *vm) {
 
   g_return_val_if_null(vm, 0);
 
-  g_mutex_lock(vm->mutex);
-  num = g_thread_pool_unprocessed(vm->threads);
-  g_mutex_unlock(vm->mutex);
+  num = g_atomic_int_get(&vm->num_queued);
 
   return num;
 }
 
 
 void push_vm_interrupt_all(push_vm_t *vm, push_int_t interrupt_flag) {
+  GQueue parked = G_QUEUE_INIT;
+  push_vm_worker_t *worker;
+  push_vm_process_t *process;
   GList *link;
+  push_int_t i;
 
   g_return_if_null(vm);
 
-  g_mutex_lock(vm->mutex);
-  for (link = vm->processes; link != NULL; link = link->next) {
-    push_interrupt((push_t*)link->data, interrupt_flag);
+  /* interrupt running and queued processes of all workers */
+  for (i = 0; i < vm->num_workers; i++) {
+    worker = &vm->workers[i];
+
+    g_mutex_lock(worker->mutex);
+    if (worker->current != NULL) {
+      push_interrupt(worker->current->push, interrupt_flag);
+    }
+    for (link = worker->fresh->head; link != NULL; link = link->next) {
+      push_interrupt(((push_vm_process_t*)link->data)->push, interrupt_flag);
+    }
+    for (link = worker->queue->head; link != NULL; link = link->next) {
+      push_interrupt(((push_vm_process_t*)link->data)->push, interrupt_flag);
+    }
+    g_mutex_unlock(worker->mutex);
+  }
+
+  /* waiting processes must run to see the interrupt */
+  if (g_atomic_int_get(&vm->num_parked) > 0) {
+    push_vm_take_parked(vm, &parked, 0);
+
+    while ((process = (push_vm_process_t*)g_queue_pop_head(&parked)) != NULL) {
+      push_interrupt(process->push, interrupt_flag);
+      push_vm_queue(vm, process, TRUE);
+    }
   }
-  g_mutex_unlock(vm->mutex);
 }
 
 
@@ -140,10 +1083,348 @@ void push_vm_kill_all(push_vm_t *vm) {
 
 
 void push_vm_wait(push_vm_t *vm) {
-  g_mutex_lock(vm->mutex);
-  while (vm->processes != NULL) {
-    g_cond_wait(vm->wait_cond, vm->mutex);
+  gint num;
+
+  g_return_if_null(vm);
+
+  g_atomic_int_inc(&vm->num_waiters);
+  while ((num = g_atomic_int_get(&vm->num_processes)) > 0) {
+    push_vm_sleep(vm, &vm->num_processes, num);
+  }
+  g_atomic_int_add(&vm->num_waiters, -1);
+}
+
+
+/* Returns file descriptor that becomes readable when processes are done,
+ * or -1 if not supported
+ * NOTE: It's an eventfd: reading it returns the number of processes done
+ *       since the last read, so it can be added to the application's poll
+ *       or epoll loop. It's created by the first call, and closed by
+ *       push_vm_destroy.
+ */
+int push_vm_get_eventfd(push_vm_t *vm) {
+  g_return_val_if_null(vm, -1);
+
+#ifdef __linux__
+  if (g_atomic_int_get(&vm->eventfd) < 0) {
+    g_mutex_lock(vm->mutex);
+    if (vm->eventfd < 0) {
+      g_atomic_int_set(&vm->eventfd, eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC));
+    }
+    g_mutex_unlock(vm->mutex);
+  }
+#endif
+
+  return g_atomic_int_get(&vm->eventfd);
+}
+
+
+
+/* Runs n processes and returns their futures (free array with g_free)
+ * NOTE: Each worker's queue is locked only once for all processes. If
+ *       completions isn't NULL, each future is pushed onto it when its
+ *       process is done, with a reference for the consumer.
+ */
+push_vm_future_t **push_vm_run_many(push_vm_t *vm, push_t **pushes, push_int_t n, GAsyncQueue *completions) {
+  push_vm_future_t **futures;
+  push_vm_process_t *process;
+  push_vm_worker_t *worker;
+  GQueue *batches;
+  GList *link;
+  push_vm_budget_t *budget;
+  push_int_t i, w, first;
+
+  g_return_val_if_null(vm, NULL);
+  g_return_val_if_fail(n >= 0, NULL);
+
+  futures = g_new(push_vm_future_t*, n);
+  if (n == 0) {
+    return futures;
+  }
+
+  budget = (push_vm_budget_t*)g_atomic_pointer_get(&vm->budget);
+
+  g_atomic_int_add(&vm->num_processes, n);
+
+  /* processes of checked out interpreters go to the worker owning their
+   * pool, others are dealt to the workers in turn
+   * NOTE: Batched per worker first, so each worker is locked once.
+   */
+  batches = g_new0(GQueue, vm->num_workers);
+  first = (guint)g_atomic_int_exchange_and_add(&vm->next_worker, n) % vm->num_workers;
+  for (i = 0; i < n; i++) {
+    futures[i] = g_slice_new(push_vm_future_t);
+    futures[i]->ref_count = 2; /* for the caller & the VM */
+    futures[i]->push = pushes[i];
+    futures[i]->steps = 0;
+    futures[i]->interrupt_flag = 0;
+    futures[i]->done = FALSE;
+    futures[i]->completions = completions != NULL ? g_async_queue_ref(completions) : NULL;
+
+    process = push_vm_new_process(vm, pushes[i], PUSH_VM_PRIORITY_DEFAULT, budget->wall_time, budget->cpu_time, futures[i]);
+
+    worker = push_vm_pool_worker(vm, pushes[i]->pool);
+    if (worker == NULL) {
+      worker = &vm->workers[(first + i) % vm->num_workers];
+    }
+    g_queue_push_tail(&batches[worker - vm->workers], process);
+  }
+
+  for (w = 0; w < vm->num_workers; w++) {
+    if (g_queue_is_empty(&batches[w])) {
+      continue;
+    }
+    worker = &vm->workers[w];
+
+    g_mutex_lock(worker->mutex);
+    /* NOTE: keep submission order for the worker */
+    while ((link = g_queue_pop_head_link(&batches[w])) != NULL) {
+      g_queue_push_tail_link(worker->fresh, link);
+    }
+    g_mutex_unlock(worker->mutex);
+  }
+  g_free(batches);
+
+  g_atomic_int_add(&vm->num_queued, n);
+  if (g_atomic_int_get(&vm->num_idle) > 0) {
+    g_mutex_lock(vm->idle_mutex);
+    g_cond_broadcast(vm->idle_cond);
+    g_mutex_unlock(vm->idle_mutex);
+  }
+
+  return futures;
+}
+
+
+push_vm_future_t *push_vm_future_ref(push_vm_future_t *future) {
+  g_return_val_if_null(future, NULL);
+
+  g_atomic_int_inc(&future->ref_count);
+
+  return future;
+}
+
+
+void push_vm_future_unref(push_vm_future_t *future) {
+  g_return_if_null(future);
+
+  if (g_atomic_int_dec_and_test(&future->ref_count)) {
+    if (future->completions != NULL) {
+      g_async_queue_unref(future->completions);
+    }
+    g_slice_free(push_vm_future_t, future);
+  }
+}
+
+
+/* Returns if the process of the future is done */
+push_bool_t push_vm_future_done(push_vm_future_t *future) {
+  g_return_val_if_null(future, FALSE);
+
+  return g_atomic_int_get(&future->done);
+}
+
+
+/* Waits until the process of the future is done */
+void push_vm_future_wait(push_vm_t *vm, push_vm_future_t *future) {
+  g_return_if_null(vm);
+  g_return_if_null(future);
+
+  if (!g_atomic_int_get(&future->done)) {
+    g_atomic_int_inc(&vm->num_waiters);
+    while (!g_atomic_int_get(&future->done)) {
+      push_vm_sleep(vm, &future->done, FALSE);
+    }
+    g_atomic_int_add(&vm->num_waiters, -1);
+  }
+}
+
+
+push_vm_waitq_t *push_vm_waitq_new(void) {
+  push_vm_waitq_t *waitq;
+
+  waitq = g_slice_new(push_vm_waitq_t);
+  waitq->signals = 0;
+  waitq->waiting = g_queue_new();
+  waitq->num_waiting = 0;
+  waitq->vms = NULL;
+  waitq->mutex = g_mutex_new();
+
+  return waitq;
+}
+
+
+/* NOTE: no process may wait for the queue anymore */
+void push_vm_waitq_destroy(push_vm_waitq_t *waitq) {
+  g_return_if_null(waitq);
+
+  g_queue_free(waitq->waiting);
+  g_slist_free(waitq->vms);
+  g_mutex_free(waitq->mutex);
+
+  g_slice_free(push_vm_waitq_t, waitq);
+}
+
+
+/* Wakes up all processes waiting for the queue
+ * NOTE: Without waiting processes, this doesn't take the lock (see
+ *       push_vm_park_process).
+ */
+void push_vm_waitq_signal(push_vm_waitq_t *waitq) {
+  GQueue woken = G_QUEUE_INIT;
+  push_vm_process_t *process;
+
+  g_return_if_null(waitq);
+
+  g_atomic_int_inc(&waitq->signals);
+
+  if (g_atomic_int_get(&waitq->num_waiting) == 0) {
+    return;
+  }
+
+  g_mutex_lock(waitq->mutex);
+  woken = *waitq->waiting;
+  g_queue_init(waitq->waiting);
+  g_atomic_int_set(&waitq->num_waiting, 0);
+  g_mutex_unlock(waitq->mutex);
+
+  while ((process = (push_vm_process_t*)g_queue_pop_head(&woken)) != NULL) {
+    process->waitq = NULL;
+    g_atomic_int_add(&process->vm->num_parked, -1);
+    push_vm_queue(process->vm, process, TRUE);
+  }
+}
+
+
+/* Lets process wait until the wait queue is signalled (called by instructions)
+ * NOTE: signals is the number of signals the instruction saw before it found
+ *       that it has to wait. The instruction must be repeatable, since it's
+ *       run again after the process was woken up. With waitq = NULL the
+ *       process just lets others run. Outside of a VM worker the interpreter
+ *       just stops. An interrupt that was raised already (e.g. a kill) isn't
+ *       replaced.
+ */
+void push_vm_park(push_t *push, push_vm_waitq_t *waitq, gint signals) {
+  push_vm_worker_t *worker;
+
+  g_return_if_null(push);
+
+  worker = (push_vm_worker_t*)g_static_private_get(&push_vm_current_worker);
+  if (worker == NULL || worker->current == NULL || worker->current->push != push) {
+    worker = NULL;
+  }
+
+  if (worker != NULL) {
+    worker->park = waitq;
+    worker->park_signals = signals;
+  }
+
+  if (!g_atomic_int_compare_and_exchange(&push->interrupt_flag, 0, PUSH_VM_INTERRUPT_YIELD) && worker != NULL) {
+    worker->park = NULL;
   }
-  g_mutex_unlock(vm->mutex);
 }
 
+
+/* Returns statistics of a worker, or of all workers if worker < 0
+ * NOTE: free with push_vm_stats_destroy
+ */
+push_vm_stats_t *push_vm_get_stats(push_vm_t *vm, push_int_t worker) {
+  push_vm_stats_t *stats, *worker_stats;
+  gint64 now;
+  push_int_t i;
+
+  g_return_val_if_null(vm, NULL);
+  g_return_val_if_fail(worker < vm->num_workers, NULL);
+
+  stats = g_slice_new0(push_vm_stats_t);
+  now = g_get_monotonic_time();
+
+  for (i = worker < 0 ? 0 : worker; i < (worker < 0 ? vm->num_workers : worker + 1); i++) {
+    g_mutex_lock(vm->workers[i].mutex);
+    worker_stats = &vm->workers[i].stats;
+
+    stats->num_workers++;
+    stats->processes += worker_stats->processes;
+    stats->slices += worker_stats->slices;
+    stats->steals += g_atomic_int_get(&vm->workers[i].steals);
+    stats->busy_time += worker_stats->busy_time;
+    stats->elapsed_time += now - vm->workers[i].stats_time;
+    push_vm_histogram_merge(&stats->wait_time, &worker_stats->wait_time);
+    push_vm_histogram_merge(&stats->run_time, &worker_stats->run_time);
+    push_vm_histogram_merge(&stats->steps, &worker_stats->steps);
+    push_vm_histogram_merge(&stats->speed, &worker_stats->speed);
+
+    g_mutex_unlock(vm->workers[i].mutex);
+  }
+
+  return stats;
+}
+
+
+void push_vm_reset_stats(push_vm_t *vm) {
+  push_vm_worker_t *worker;
+  push_int_t i;
+
+  g_return_if_null(vm);
+
+  for (i = 0; i < vm->num_workers; i++) {
+    worker = &vm->workers[i];
+
+    g_mutex_lock(worker->mutex);
+    memset(&worker->stats, 0, sizeof(push_vm_stats_t));
+    g_atomic_int_set(&worker->steals, 0);
+    worker->stats_time = g_get_monotonic_time();
+    g_mutex_unlock(worker->mutex);
+  }
+}
+
+
+void push_vm_stats_destroy(push_vm_stats_t *stats) {
+  g_return_if_null(stats);
+
+  g_slice_free(push_vm_stats_t, stats);
+}
+
+
+/* Returns the fraction of time workers ran processes */
+push_real_t push_vm_stats_utilization(push_vm_stats_t *stats) {
+  g_return_val_if_null(stats, 0.0);
+
+  return stats->elapsed_time > 0 ? (push_real_t)stats->busy_time / stats->elapsed_time : 0.0;
+}
+
+
+push_real_t push_vm_histogram_mean(push_vm_histogram_t *histogram) {
+  g_return_val_if_null(histogram, 0.0);
+
+  return histogram->count > 0 ? (push_real_t)histogram->sum / histogram->count : 0.0;
+}
+
+
+/* Returns a value that percentile (0.0 to 1.0) of the values don't exceed
+ * NOTE: This is the upper end of a bucket, so it's at most twice the exact
+ *       value (but never more than the max).
+ */
+gint64 push_vm_histogram_percentile(push_vm_histogram_t *histogram, push_real_t percentile) {
+  guint64 rank, count = 0;
+  guint i;
+
+  g_return_val_if_null(histogram, 0);
+
+  if (histogram->count == 0) {
+    return 0;
+  }
+
+  rank = (guint64)(CLAMP(percentile, 0.0, 1.0) * histogram->count);
+  rank = CLAMP(rank, 1, histogram->count);
+
+  for (i = 0; i < PUSH_VM_HISTOGRAM_BUCKETS - 1; i++) {
+    count += histogram->buckets[i];
+    if (count >= rank) {
+      break;
+    }
+  }
+
+  /* bucket i holds values in [2^(i-1), 2^i) */
+  return i == 0 ? 0 : CLAMP(((gint64)1 << i) - 1, histogram->min, histogram->max);
+}